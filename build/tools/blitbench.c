@@ -0,0 +1,146 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// converts random VRAM frames with the SIMD blit path of this build (SSE2 or
+// NEON) and with the scalar one, checks that they match and reports the time
+// per frame of both, e.g.
+// blitbench 200
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "core/blit.h"
+
+#if defined(TIC_BLIT_NEON)
+#	define BLIT_PATH "NEON"
+#elif defined(TIC_BLIT_SSE2)
+#	define BLIT_PATH "SSE2"
+#else
+#	define BLIT_PATH "scalar"
+#endif
+
+// frames converted per sample, a single one is too short for clock()
+enum {RowSize = TIC80_WIDTH / 2, Frames = 100};
+
+static double now()
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static u32 rnd()
+{
+	static u32 seed = 0x12345678;
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+// same as blitRow with the scalar converter
+static void scalarRow(const BlitLut* lut, u32* dst, const u8* src, s32 pos)
+{
+	if(pos == 0)
+		blitNibblesScalar(lut, dst, src, RowSize);
+	else
+	{
+		u32 row[TIC80_WIDTH];
+		blitNibblesScalar(lut, row, src, RowSize);
+
+		memcpy(dst + pos, row, (TIC80_WIDTH - pos) * sizeof *row);
+		memcpy(dst, row + TIC80_WIDTH - pos, pos * sizeof *row);
+	}
+}
+
+static double bench(const BlitLut* lut, u32* screen, const u8* vram, s32 pos, int iterations, bool simd)
+{
+	double best = 0;
+
+	for(int i = 0; i < iterations; i++)
+	{
+		double start = now();
+
+		for(s32 f = 0; f < Frames; f++)
+			for(s32 y = 0; y < TIC80_HEIGHT; y++)
+				simd
+					? blitRow(lut, screen + y * TIC80_WIDTH, vram + y * RowSize, pos)
+					: scalarRow(lut, screen + y * TIC80_WIDTH, vram + y * RowSize, pos);
+
+		double time = (now() - start) / Frames;
+		if(i == 0 || time < best) best = time;
+	}
+
+	return best;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc > 2)
+	{
+		printf("usage: blitbench [iterations]\n");
+		return -1;
+	}
+
+	int iterations = argc > 1 ? atoi(argv[1]) : 100;
+
+	static u8 vram[RowSize * TIC80_HEIGHT];
+	static u32 expected[TIC80_WIDTH * TIC80_HEIGHT];
+	static u32 screen[TIC80_WIDTH * TIC80_HEIGHT];
+	u32 pal[TIC_PALETTE_SIZE];
+
+	for(s32 i = 0; i < sizeof vram; i++)
+		vram[i] = (u8)rnd();
+
+	for(s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+		pal[i] = rnd();
+
+	BlitLut lut;
+	initBlitLut(&lut, pal);
+
+	// the SIMD path has to give the same pixels for every row offset it takes
+	for(s32 pos = 0; pos < TIC80_WIDTH; pos++)
+	{
+		for(s32 y = 0; y < TIC80_HEIGHT; y++)
+		{
+			scalarRow(&lut, expected + y * TIC80_WIDTH, vram + y * RowSize, pos);
+			blitRow(&lut, screen + y * TIC80_WIDTH, vram + y * RowSize, pos);
+		}
+
+		if(memcmp(expected, screen, sizeof screen))
+		{
+			printf("%s blit differs from scalar at offset %d\n", BLIT_PATH, pos);
+			return 1;
+		}
+	}
+
+	printf("frame %dx%d, best of %d\n", TIC80_WIDTH, TIC80_HEIGHT, iterations);
+
+	// offset rows go through a temporary row, like scrolled screens do
+	for(s32 pos = 0; pos <= 7; pos += 7)
+	{
+		double scalar = bench(&lut, screen, vram, pos, iterations, false);
+		double simd = bench(&lut, screen, vram, pos, iterations, true);
+
+		printf("offset %d: scalar %.1f us, %s %.1f us, %.1fx\n",
+			pos, scalar * 1e6, BLIT_PATH, simd * 1e6, simd > 0 ? scalar / simd : 0);
+	}
+
+	return 0;
+}
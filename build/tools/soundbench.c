@@ -0,0 +1,110 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// renders a music track of a project with the offline renderer and reports
+// the time spent in the tracker and the synthesizer, e.g.
+// soundbench demos/music.lua 0 50
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "studio/project.h"
+#include "api.h"
+
+static double now()
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void onSamples(void* data, const s16* samples, s32 count)
+{
+	*(s32*)data += count;
+}
+
+int main(int argc, char** argv)
+{
+	int res = -1;
+
+	if(argc >= 2 && argc <= 4)
+	{
+		int track = argc > 2 ? atoi(argv[2]) : 0;
+		int iterations = argc > 3 ? atoi(argv[3]) : 20;
+
+		FILE* project = fopen(argv[1], "rb");
+
+		if(project)
+		{
+			fseek(project, 0, SEEK_END);
+			int size = ftell(project);
+			fseek(project, 0, SEEK_SET);
+
+			unsigned char* buffer = (unsigned char*)malloc(size);
+			tic_cartridge* cart = calloc(1, sizeof(tic_cartridge));
+
+			if(buffer && cart)
+			{
+				fread(buffer, size, 1, project);
+
+				tic_project_load(argv[1], (char*)buffer, size, cart);
+
+				double best = 0, total = 0;
+				s32 samples = 0;
+
+				for(int i = 0; i < iterations; i++)
+				{
+					samples = 0;
+
+					tic_sound_render job =
+					{
+						.sfx = &cart->banks[0].sfx,
+						.music = &cart->banks[0].music,
+						.track = track,
+						.output = onSamples,
+						.data = &samples,
+					};
+
+					double start = now();
+					tic_core_render_sound(TIC80_SAMPLERATE, &job);
+					double time = now() - start;
+
+					total += time;
+					if(i == 0 || time < best) best = time;
+				}
+
+				double seconds = (double)samples / TIC_STEREO_CHANNELS / TIC80_SAMPLERATE;
+
+				printf("track %d: %.2f s of audio, best %.3f ms, avg %.3f ms, %.0fx realtime\n", 
+					track, seconds, best * 1000, iterations ? total * 1000 / iterations : 0, best > 0 ? seconds / best : 0);
+
+				res = 0;
+			}
+
+			free(buffer);
+			free(cart);
+			fclose(project);
+		}
+		else printf("cannot open project file\n");
+	}
+	else printf("usage: soundbench <project> [track] [iterations]\n");
+
+	return res;
+}
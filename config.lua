@@ -37,7 +37,10 @@ THEME=
 
 CHECK_NEW_VERSION=true
 NO_SOUND=false
-GIF_LENGTH=20 -- in seconds
+AUDIO_THREAD=false
+GIF_LENGTH=20 -- in seconds, 0 records until stopped
+CPU_BUDGET=0 -- VM instructions per frame, 0 is unlimited
+SCRIPT_MEMORY=0 -- script heap limit in KB, 0 is unlimited
 CRT_MONITOR=false
 GIF_SCALE=3
 UI_SCALE=4
@@ -134,11 +134,46 @@ typedef struct
 
 } tic80_input;
 
+typedef struct
+{
+	// output sample rate, TIC80_SAMPLERATE when 0
+	s32 samplerate;
+
+	// 1 - mono mixdown, 2 - interleaved stereo (default)
+	s32 channels;
+
+	// 0 - samples of every tick are returned in tic80.sound,
+	// otherwise the host pulls blocks of any size with tic80_sound_read
+	// and latency is how much audio in ms can be queued ahead of it
+	s32 latency;
+} tic80_sound_config;
+
+typedef struct
+{
+	// bytes allocated by the script VM, now and at most since it was created
+	u32 live;
+	u32 peak;
+
+	// allocations refused because of the memory limit
+	u32 failed;
+} tic80_script_memory;
+
 TIC80_API tic80* tic80_create(s32 samplerate);
+TIC80_API tic80* tic80_create_ex(const tic80_sound_config* sound);
 TIC80_API void tic80_load(tic80* tic, void* cart, s32 size);
+// loads a .tic file, mapped into memory where supported
+TIC80_API bool tic80_load_file(tic80* tic, const char* path);
 TIC80_API void tic80_tick(tic80* tic, const tic80_input* input);
 TIC80_API void tic80_delete(tic80* tic);
 
+// count is the number of s16 values, can be called from the audio thread
+TIC80_API void tic80_sound_read(tic80* tic, s16* samples, s32 count);
+
+// VM instructions per frame and bytes of the script VM heap a cart may use,
+// 0 is unlimited, applied to the carts loaded afterwards
+TIC80_API void tic80_script_limits(tic80* tic, u64 budget, u32 memory);
+TIC80_API void tic80_script_stats(tic80* tic, tic80_script_memory* stats);
+
 #ifdef __cplusplus
 }
 #endif
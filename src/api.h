@@ -27,6 +27,11 @@
 typedef struct { u8 index; tic_flip flip; tic_rotate rotate; } RemapResult;
 typedef void(*RemapFunc)(void*, s32 x, s32 y, RemapResult* result);
 
+// batched map() remap, called once with the visible w*h cells in row-major order
+// starting at map cell (x, y), coordinates are not wrapped
+#define TIC_MAP_BATCH_SIZE ((TIC80_WIDTH / TIC_SPRITESIZE + 1) * (TIC80_HEIGHT / TIC_SPRITESIZE + 1))
+typedef void(*RemapBatchFunc)(void*, s32 x, s32 y, s32 w, s32 h, RemapResult* cells);
+
 typedef void(*TraceOutput)(void*, const char*, u8 color);
 typedef void(*ErrorOutput)(void*, const char*);
 typedef void(*ExitCallback)(void*);
@@ -43,6 +48,17 @@ typedef struct
     u64 (*freq)(void*);
     u64 start;
 
+    // VM instructions the script may run per frame before it's interrupted, 0 is unlimited
+    u64 budget;
+
+    // bytes the script VM may allocate, 0 is unlimited
+    u32 memory;
+
+    // optional persistent cache for compiled scripts, the key is a hex md5 string,
+    // buffers are checked by the core before use
+    void* (*cacheLoad)(void*, const char* key, s32* size);
+    void (*cacheSave)(void*, const char* key, const void* buffer, s32 size);
+
     void* data;
 } tic_tick_data;
 
@@ -67,6 +83,10 @@ typedef struct
         tic_tick tick;
         tic_scanline scanline;
         tic_overline overline;
+
+        // steps the garbage collector until tic_tick_data.counter reaches
+        // the deadline, does one step when the deadline is 0
+        void(*collect)(tic_mem* memory, u64 deadline);
     };
 
     const tic_outline_item* (*getOutline)(const char* code, s32* size);
@@ -114,7 +134,7 @@ typedef struct
     macro(btn,          1,  u32,        tic_mem*, s32 id) \
     macro(btnp,         3,  u32,        tic_mem*, s32 id, s32 hold, s32 period) \
     macro(sfx,          6,  void,       tic_mem*, s32 index, s32 note, s32 octave, s32 duration, s32 channel, s32 left, s32 right, s32 speed) \
-    macro(map,          9,  void,       tic_mem*, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapFunc remap, void* data) \
+    macro(map,          10, void,       tic_mem*, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapFunc remap, void* data) \
     macro(mget,         2,  u8,         tic_mem*, s32 x, s32 y) \
     macro(mset,         3,  void,       tic_mem*, s32 x, s32 y, u8 value) \
     macro(peek,         1,  u8,         tic_mem*, s32 address) \
@@ -133,7 +153,8 @@ typedef struct
     macro(circ,         4,  void,       tic_mem*, s32 x, s32 y, s32 radius, u8 color) \
     macro(circb,        4,  void,       tic_mem*, s32 x, s32 y, s32 radius, u8 color) \
     macro(tri,          7,  void,       tic_mem*, s32 x1, s32 y1, s32 x2, s32 y2, s32 x3, s32 y3, u8 color) \
-    macro(textri,       14, void,       tic_mem*, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count) \
+    macro(textri,       17, void,       tic_mem*, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count, float z1, float z2, float z3, bool depth) \
+    macro(mesh,         6,  void,       tic_mem*, const float* vertices, s32 vcount, const s32* indices, s32 icount, s32 color, bool use_map, u8* colors, s32 count, bool cull) \
     macro(clip,         4,  void,       tic_mem*, s32 x, s32 y, s32 width, s32 height) \
     macro(music,        4,  void,       tic_mem*, s32 track, s32 frame, s32 row, bool loop, bool sustain) \
     macro(sync,         3,  void,       tic_mem*, u32 mask, s32 bank, bool toCart) \
@@ -193,10 +214,109 @@ void tic_core_blit(tic_mem* tic, tic80_pixel_color_format fmt);
 void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data);
 const tic_script_config* tic_core_script_config(tic_mem* memory);
 
+// call after drawing into tic->screen outside of OVR, rows are in TIC80_HEIGHT space
+void tic_core_blit_invalidate(tic_mem* tic, s32 y, s32 height);
+
+typedef struct tic_sound_stream tic_sound_stream;
+
+// streaming mode, the tick only queues sound registers and samples are
+// synthesized by tic_core_sound_read() called from the audio device thread,
+// frames is the max number of ticks queued ahead (latency), 0 disables it,
+// change it only when the device is closed
+bool tic_core_sound_stream(tic_mem* memory, s32 frames);
+// count is the number of s16 values (whole stereo frames), missing ticks
+// repeat the last registers for a few frames
+void tic_core_sound_read(tic_mem* memory, s16* samples, s32 count);
+
+// interleaved stereo samples, count is the number of s16 values
+typedef void(*tic_sound_output)(void* data, const s16* samples, s32 count);
+
+typedef struct
+{
+    const tic_sfx* sfx;
+    const tic_music* music;
+
+    s32 track;      // music track to render or -1 to render the sfx below
+    s32 index;      // sfx index, played like in the sfx editor
+    bool sustain;
+    u8 mute;        // muted channels mask
+
+    tic_sound_output output;
+    void* data;
+
+    bool done;
+} tic_sound_render;
+
+// offline rendering, runs only the tracker and the synthesizer on a private core
+bool tic_core_render_sound(s32 samplerate, tic_sound_render* job);
+// renders jobs on up to threads workers (0 - one per cpu core), outputs of
+// different jobs can be called concurrently
+void tic_core_render_sounds(s32 samplerate, tic_sound_render* jobs, s32 count, s32 threads);
+
+#define TIC_PROFILE_FRAMES 64
+
+//                  PROFILER PHASES
+//      .------------------------------------------- - - -
+//      |   NAME    | LABEL   | DESCRIPTION
+#define TIC_PROFILE_LIST(macro)                                         \
+    macro(music,    "MUSIC",  "music and sfx state update")             \
+    macro(tick,     "TIC",    "script TIC() callback")                  \
+    macro(sound,    "SOUND",  "waveform synthesis")                     \
+    macro(blit,     "BLIT",   "VRAM to screen conversion")              \
+    macro(scanline, "SCN",    "script SCN() callbacks")                 \
+    macro(overline, "OVR",    "script OVR() callback")                  \
+    macro(gc,       "GC",     "garbage collection after the blit")
+
+typedef enum
+{
+#define ENUM_ITEM(name, ...) tic_profile_##name,
+    TIC_PROFILE_LIST(ENUM_ITEM)
+#undef ENUM_ITEM
+
+    tic_profile_count
+} tic_profile_phase;
+
+typedef struct
+{
+    u64 time[tic_profile_count];
+
+    // screen rows converted by the blit
+    s32 rows;
+} tic_profile_frame;
+
+// per-phase timings of the running cart in tic_tick_data.counter units,
+// `frame` is the ring slot being recorded, the `count` slots before it are complete
+typedef struct
+{
+    bool enabled;
+    u64 freq;
+    s32 frame;
+    s32 count;
+    tic_profile_frame frames[TIC_PROFILE_FRAMES];
+} tic_profile;
+
+void tic_core_profile(tic_mem* memory, bool enable);
+const tic_profile* tic_core_profile_data(tic_mem* memory);
+const tic80_script_memory* tic_core_script_memory(tic_mem* memory);
+
 typedef struct
 {
     tic80 tic;
     tic_mem* memory;
     tic_tick_data tickData;
     u64 tick_counter;
+
+    // copied to tickData on every load
+    struct
+    {
+        u64 budget;
+        u32 memory;
+    } limits;
+
+    struct
+    {
+        s32 channels;
+        bool stream;
+        s16* mono;
+    } sound;
 } tic80_local;
@@ -27,6 +27,7 @@
 #include "tools.h"
 
 #include <ctype.h>
+#include <stdlib.h>
 
 #include "duktape.h"
 
@@ -40,6 +41,8 @@ static void closeJavascript(tic_mem* tic)
     {
         duk_destroy_heap(core->js);
         core->js = NULL;
+
+        tic_core_alloc_release(tic);
     }
 }
 
@@ -408,6 +411,75 @@ static void remapCallback(void* data, s32 x, s32 y, RemapResult* result)
     duk_pop(duk);
 }
 
+// field: 0 - index, 1 - flip, 2 - rotate
+static void getRemapBatchArray(duk_context* duk, duk_idx_t index, s32 count, RemapResult* cells, s32 field)
+{
+    for(s32 i = 0; i < count; i++)
+    {
+        duk_get_prop_index(duk, index, i);
+        s32 value = duk_to_int(duk, -1);
+        duk_pop(duk);
+
+        switch(field)
+        {
+        case 0: cells[i].index = value; break;
+        case 1: cells[i].flip = value; break;
+        case 2: cells[i].rotate = value; break;
+        }
+    }
+}
+
+// remap(ids, x, y, w, h) gets the visible cells as a row-major array and returns
+// nothing (ids modified in place), an array of ids or [ids, flips, rotates]
+static void remapBatchCallback(void* data, s32 x, s32 y, s32 w, s32 h, RemapResult* cells)
+{
+    RemapData* remap = (RemapData*)data;
+    duk_context* duk = remap->duk;
+    const s32 count = w * h;
+
+    duk_idx_t ids = duk_push_array(duk);
+
+    for(s32 i = 0; i < count; i++)
+    {
+        duk_push_int(duk, cells[i].index);
+        duk_put_prop_index(duk, ids, i);
+    }
+
+    duk_push_heapptr(duk, remap->remap);
+    duk_dup(duk, ids);
+    duk_push_int(duk, x);
+    duk_push_int(duk, y);
+    duk_push_int(duk, w);
+    duk_push_int(duk, h);
+
+    if(duk_pcall(duk, 5) == DUK_EXEC_SUCCESS)
+    {
+        duk_idx_t ret = duk_get_top_index(duk);
+
+        if(duk_is_array(duk, ret))
+        {
+            duk_get_prop_index(duk, ret, 0);
+            bool triple = duk_is_array(duk, -1);
+            duk_pop(duk);
+
+            if(triple)
+            {
+                for(s32 i = 0; i < 3; i++)
+                {
+                    duk_get_prop_index(duk, ret, i);
+                    if(duk_is_array(duk, -1))
+                        getRemapBatchArray(duk, duk_get_top_index(duk), count, cells, i);
+                    duk_pop(duk);
+                }
+            }
+            else getRemapBatchArray(duk, ret, count, cells, 0);
+        }
+        else getRemapBatchArray(duk, ids, count, cells, 0);
+    }
+
+    duk_pop_2(duk);
+}
+
 static duk_ret_t duk_map(duk_context* duk)
 {
     s32 x = duk_opt_int(duk, 0, 0);
@@ -460,7 +532,10 @@ static duk_ret_t duk_map(duk_context* duk)
 
         RemapData data = {duk, remap};
 
-        tic_api_map((tic_mem*)getDukCore(duk), x, y, w, h, sx, sy, colors, count, scale, remapCallback, &data);
+        if(duk_opt_boolean(duk, 9, false))
+            tic_core_map_batch(tic, x, y, w, h, sx, sy, colors, count, scale, remapBatchCallback, &data);
+        else
+            tic_api_map(tic, x, y, w, h, sx, sy, colors, count, scale, remapCallback, &data);
     }
 
     return 0;
@@ -760,6 +835,14 @@ static duk_ret_t duk_textri(duk_context* duk)
         }
     }
 
+    //  check for perspective correction
+    float z[3] = {0};
+    bool depth = !duk_is_null_or_undefined(duk, 16);
+
+    if(depth)
+        for (s32 i = 0; i < COUNT_OF(z); i++)
+            z[i] = (float)duk_to_number(duk, i + 14);
+
     tic_api_textri(tic, pt[0], pt[1],   //  xy 1
                         pt[2], pt[3],   //  xy 2
                         pt[4], pt[5],   //  xy 3
@@ -767,11 +850,114 @@ static duk_ret_t duk_textri(duk_context* duk)
                         pt[8], pt[9],   //  uv 2
                         pt[10], pt[11],//  uv 3
                         use_map, // usemap
-                        colors, count);    //  chroma
+                        colors, count,    //  chroma
+                        z[0], z[1], z[2], depth); // perspective
 
     return 0;
 }
 
+//  arrays and typed arrays are both read element by element
+static bool isDukArrayLike(duk_context* duk, duk_idx_t index)
+{
+    return duk_is_array(duk, index) || duk_is_buffer_data(duk, index);
+}
+
+static duk_ret_t duk_mesh(duk_context* duk)
+{
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+
+    s32 color = duk_opt_int(duk, 2, -1);
+    bool use_map = duk_opt_boolean(duk, 3, false);
+    bool cull = duk_opt_boolean(duk, 5, false);
+    const s32 stride = color < 0 ? 4 : 2;
+
+    static u8 colors[TIC_PALETTE_SIZE];
+    s32 count = 0;
+    {
+        if(!duk_is_null_or_undefined(duk, 4))
+        {
+            if(duk_is_array(duk, 4))
+            {
+                for(s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+                {
+                    duk_get_prop_index(duk, 4, i);
+                    if(duk_is_null_or_undefined(duk, -1))
+                    {
+                        duk_pop(duk);
+                        break;
+                    }
+                    else
+                    {
+                        colors[i] = duk_to_int(duk, -1);
+                        count++;
+                        duk_pop(duk);
+                    }
+                }
+            }
+            else
+            {
+                colors[0] = duk_to_int(duk, 4);
+                count = 1;
+            }
+        }
+    }
+
+    s32* indices = NULL;
+    s32 icount = 0;
+
+    if(isDukArrayLike(duk, 1))
+    {
+        icount = (s32)duk_get_length(duk, 1);
+
+        // an empty index list draws nothing
+        if(icount == 0)
+            return 0;
+
+        // scratch lists live on the value stack, the getters below can throw
+        indices = duk_push_fixed_buffer(duk, icount * sizeof(s32));
+
+        for(s32 i = 0; i < icount; i++)
+        {
+            duk_get_prop_index(duk, 1, i);
+            indices[i] = duk_to_int(duk, -1);
+            duk_pop(duk);
+        }
+    }
+
+    float* vertices = NULL;
+    float* ram = NULL;
+    s32 vcount = 0;
+
+    if(isDukArrayLike(duk, 0))
+    {
+        vcount = (s32)duk_get_length(duk, 0) / stride;
+
+        if(vcount == 0)
+            return 0;
+
+        vertices = duk_push_fixed_buffer(duk, vcount * stride * sizeof(float));
+
+        for(s32 i = 0; i < vcount * stride; i++)
+        {
+            duk_get_prop_index(duk, 0, i);
+            vertices[i] = (float)duk_to_number(duk, -1);
+            duk_pop(duk);
+        }
+    }
+    else if(duk_is_number(duk, 0) && indices)
+    {
+        if(!(vertices = ram = tic_core_mesh_ram(tic, duk_to_int(duk, 0), stride, indices, icount, &vcount)))
+            return duk_error(duk, DUK_ERR_ERROR, "mesh: not enough memory\n");
+    }
+    else
+        return duk_error(duk, DUK_ERR_ERROR, "invalid parameters, mesh(vertices,[indices],[color=-1],[use_map=false],[chroma=off],[cull=false])\n");
+
+    tic_api_mesh(tic, vertices, vcount, indices, icount, color, use_map, colors, count, cull);
+
+    free(ram);
+
+    return 0;
+}
 
 static duk_ret_t duk_clip(duk_context* duk)
 {
@@ -859,21 +1045,44 @@ static duk_ret_t duk_fset(duk_context* duk)
     return 0;
 }
 
-static u64 ForceExitCounter = 0;
+// duktape runs the timeout check about every 256K bytecode instructions
+#define JS_CHECK_INSTRUCTIONS (256 * 1024)
 
 s32 duk_timeout_check(void* udata)
 {
-    tic_core* core = (tic_core*)udata;
-    tic_tick_data* tick = core->data;
+    return tic_core_budget_charge((tic_mem*)udata, JS_CHECK_INSTRUCTIONS) != NULL;
+}
+
+static void* allocJs(void* udata, duk_size_t size)
+{
+    return tic_core_realloc(udata, NULL, size);
+}
+
+static void* reallocJs(void* udata, void* ptr, duk_size_t size)
+{
+    return tic_core_realloc(udata, ptr, size);
+}
 
-    return ForceExitCounter++ > 1000 ? tick->forceExit && tick->forceExit(tick->data) : false;
+static void freeJs(void* udata, void* ptr)
+{
+    tic_core_realloc(udata, ptr, 0);
 }
 
-static void initDuktape(tic_core* core)
+static bool initDuktape(tic_core* core)
 {
     closeJavascript((tic_mem*)core);
 
-    duk_context* duk = core->js = duk_create_heap(NULL, NULL, NULL, core, NULL);
+    tic_core_alloc_acquire((tic_mem*)core);
+
+    duk_context* duk = core->js = duk_create_heap(allocJs, reallocJs, freeJs, core, NULL);
+
+    if(!duk)
+    {
+        tic_core_alloc_release((tic_mem*)core);
+        return false;
+    }
+
+    core->callback.tic = core->callback.scn = core->callback.scanline = core->callback.ovr = false;
 
     {
         duk_push_global_stash(duk);
@@ -891,13 +1100,20 @@ static void initDuktape(tic_core* core)
         duk_push_c_function(core->js, ApiItems[i].func, ApiItems[i].params);
         duk_put_global_string(core->js, ApiItems[i].name);
     }
+
+    return true;
 }
 
 static bool initJavascript(tic_mem* tic, const char* code)
 {
     tic_core* core = (tic_core*)tic;
 
-    initDuktape(core);
+    if(!initDuktape(core))
+    {
+        core->data->error(core->data->data, "not enough memory");
+        return false;
+    }
+
     duk_context* duktape = core->js;
 
     if (duk_pcompile_string(duktape, 0, code) != 0 || duk_peval_string(duktape, code) != 0)
@@ -910,51 +1126,92 @@ static bool initJavascript(tic_mem* tic, const char* code)
     return true;
 }
 
-static void callJavascriptTick(tic_mem* tic)
+enum {JsTic, JsScn, JsScanline, JsOvr};
+
+// the callbacks are kept in the global stash by index and resolved
+// once per frame instead of looking up the globals on every call
+static void resolveJsCallback(duk_context* duk, s32* present, duk_uarridx_t index, const char* name)
+{
+    duk_push_global_stash(duk);
+    duk_get_global_string(duk, name);
+    *present = duk_is_function(duk, -1);
+    duk_put_prop_index(duk, -2, index);
+    duk_pop(duk);
+}
+
+static void resolveJsCallbacks(tic_core* core)
+{
+    duk_context* duk = core->js;
+
+    resolveJsCallback(duk, &core->callback.tic, JsTic, TIC_FN);
+    resolveJsCallback(duk, &core->callback.scn, JsScn, SCN_FN);
+    resolveJsCallback(duk, &core->callback.scanline, JsScanline, "scanline");
+    resolveJsCallback(duk, &core->callback.ovr, JsOvr, OVR_FN);
+}
+
+static void pushJsCallback(duk_context* duk, duk_uarridx_t index)
 {
-    ForceExitCounter = 0;
+    duk_push_global_stash(duk);
+    duk_get_prop_index(duk, -1, index);
+    duk_remove(duk, -2);
+}
 
+static void callJavascriptTick(tic_mem* tic)
+{
     tic_core* core = (tic_core*)tic;
 
     duk_context* duk = core->js;
 
     if(duk)
     {
-        if(duk_get_global_string(duk, TIC_FN))
+        if(!core->callback.tic)
+            resolveJsCallbacks(core);
+
+        if(core->callback.tic)
         {
+            pushJsCallback(duk, JsTic);
+
             if(duk_pcall(duk, 0) != DUK_EXEC_SUCCESS)
             {
                 core->data->error(core->data->data, duk_safe_to_stacktrace(duk, -1));
             }
+            else if(tic_core_budget_aborted(tic))
+                core->data->error(core->data->data, tic_core_budget_aborted(tic));
+
+            duk_pop(duk);
+
+            resolveJsCallbacks(core);
         }
         else core->data->error(core->data->data, "'function TIC()...' isn't found :(");
-
-        duk_pop(duk);
     }
 }
 
-static void callJavascriptScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static void callJavascriptScanlineIndex(tic_mem* tic, s32 row, duk_uarridx_t index)
 {
     tic_core* core = (tic_core*)tic;
     duk_context* duk = core->js;
 
-    if(duk_get_global_string(duk, name))
-    {
-        duk_push_int(duk, row);
+    pushJsCallback(duk, index);
+    duk_push_int(duk, row);
 
-        if(duk_pcall(duk, 1) != 0)
-            core->data->error(core->data->data, duk_safe_to_stacktrace(duk, -1));
-    }
+    if(duk_pcall(duk, 1) != 0)
+        core->data->error(core->data->data, duk_safe_to_stacktrace(duk, -1));
+    else if(tic_core_budget_aborted(tic))
+        core->data->error(core->data->data, tic_core_budget_aborted(tic));
 
     duk_pop(duk);
 }
 
 static void callJavascriptScanline(tic_mem* tic, s32 row, void* data)
 {
-    callJavascriptScanlineName(tic, row, data, SCN_FN);
+    tic_core* core = (tic_core*)tic;
+
+    if(core->callback.scn)
+        callJavascriptScanlineIndex(tic, row, JsScn);
 
     // try to call old scanline
-    callJavascriptScanlineName(tic, row, data, "scanline");
+    if(core->callback.scanline)
+        callJavascriptScanlineIndex(tic, row, JsScanline);
 }
 
 static void callJavascriptOverline(tic_mem* tic, void* data)
@@ -962,13 +1219,36 @@ static void callJavascriptOverline(tic_mem* tic, void* data)
     tic_core* core = (tic_core*)tic;
     duk_context* duk = core->js;
 
-    if(duk_get_global_string(duk, OVR_FN))
+    if(core->callback.ovr)
     {
+        pushJsCallback(duk, JsOvr);
+
         if(duk_pcall(duk, 0) != 0)
             core->data->error(core->data->data, duk_safe_to_stacktrace(duk, -1));
+        else if(tic_core_budget_aborted(tic))
+            core->data->error(core->data->data, tic_core_budget_aborted(tic));
+
+        duk_pop(duk);
     }
+}
 
-    duk_pop(duk);
+// duktape has no incremental collector and refcounting frees most of the
+// garbage, so the full mark-and-sweep for cycles runs once a second, only
+// when at least half a frame is left; otherwise (or with a coarse timer)
+// duktape stays on its own voluntary gc schedule
+static void collectJavascript(tic_mem* tic, u64 deadline)
+{
+    tic_core* core = (tic_core*)tic;
+    duk_context* duk = core->js;
+
+    if(duk && deadline && core->gc.count % TIC80_FRAMERATE == 0)
+    {
+        u64 now = core->data->counter(core->data->data);
+        u64 frame = core->data->freq(core->data->data) / TIC80_FRAMERATE;
+
+        if(now < deadline && deadline - now >= frame / 2)
+            duk_gc(duk, 0);
+    }
 }
 
 static const char* const JsKeywords [] =
@@ -1053,6 +1333,7 @@ static const tic_script_config JsSyntaxConfig =
     .tick               = callJavascriptTick,
     .scanline           = callJavascriptScanline,
     .overline           = callJavascriptOverline,
+    .collect            = collectJavascript,
 
     .getOutline         = getJsOutline,
     .eval               = evalJs,
@@ -26,14 +26,13 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 #include <lua.h>
 #include <lauxlib.h>
 #include <lualib.h>
 #include <ctype.h>
 
-#define LUA_LOC_STACK 100000000
-
-static const char TicCore[] = "_TIC80";
+#include "ext/md5.h"
 
 s32 luaopen_lpeg(lua_State *lua);
 
@@ -49,12 +48,10 @@ static void registerLuaFunction(tic_core* core, lua_CFunction func, const char *
     lua_setglobal(core->lua, name);
 }
 
+// the core is kept in the extra space of the state, coroutines get a copy of it
 static tic_core* getLuaCore(lua_State* lua)
 {
-    lua_getglobal(lua, TicCore);
-    tic_core* core = lua_touserdata(lua, -1);
-    lua_pop(lua, 1);
-    return core;
+    return *(tic_core**)lua_getextraspace(lua);
 }
 
 static s32 lua_peek(lua_State* lua)
@@ -338,6 +335,14 @@ static s32 lua_textri(lua_State* lua)
             }
         }
 
+        //  check for perspective correction
+        float z[3] = {0};
+        bool depth = top >= 17;
+
+        if(depth)
+            for (s32 i = 0; i < COUNT_OF(z); i++)
+                z[i] = (float)lua_tonumber(lua, i + 15);
+
         tic_api_textri(tic, pt[0], pt[1],   //  xy 1
                                     pt[2], pt[3],   //  xy 2
                                     pt[4], pt[5],   //  xy 3
@@ -345,12 +350,110 @@ static s32 lua_textri(lua_State* lua)
                                     pt[8], pt[9],   //  uv 2
                                     pt[10], pt[11], //  uv 3
                                     use_map,        // use map
-                                    colors, count);        // chroma
+                                    colors, count,  // chroma
+                                    z[0], z[1], z[2], depth); // perspective
     }
-    else luaL_error(lua, "invalid parameters, textri(x1,y1,x2,y2,x3,y3,u1,v1,u2,v2,u3,v3,[use_map=false],[chroma=off])\n");
+    else luaL_error(lua, "invalid parameters, textri(x1,y1,x2,y2,x3,y3,u1,v1,u2,v2,u3,v3,[use_map=false],[chroma=off],[z1,z2,z3])\n");
     return 0;
 }
 
+static s32 lua_mesh(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+
+    if(top >= 1 && (lua_istable(lua, 1) || lua_isnumber(lua, 1)))
+    {
+        tic_mem* tic = (tic_mem*)getLuaCore(lua);
+        static u8 colors[TIC_PALETTE_SIZE];
+        s32 count = 0;
+
+        s32 color = top >= 3 && !lua_isnil(lua, 3) ? getLuaNumber(lua, 3) : -1;
+        bool use_map = top >= 4 && lua_toboolean(lua, 4);
+        bool cull = top >= 6 && lua_toboolean(lua, 6);
+        const s32 stride = color < 0 ? 4 : 2;
+
+        if(top >= 5 && !lua_isnil(lua, 5))
+        {
+            if(lua_istable(lua, 5))
+            {
+                for(s32 i = 1; i <= TIC_PALETTE_SIZE; i++)
+                {
+                    lua_rawgeti(lua, 5, i);
+                    bool number = lua_isnumber(lua, -1);
+
+                    if(number)
+                        colors[count++] = getLuaNumber(lua, -1);
+
+                    lua_pop(lua, 1);
+
+                    if(!number) break;
+                }
+            }
+            else
+            {
+                colors[0] = getLuaNumber(lua, 5);
+                count = 1;
+            }
+        }
+
+        //  indices are 1-based like the vertices table
+        s32* indices = NULL;
+        s32 icount = 0;
+
+        if(top >= 2 && lua_istable(lua, 2))
+        {
+            icount = (s32)lua_rawlen(lua, 2);
+
+            // an empty index list draws nothing
+            if(icount == 0)
+                return 0;
+
+            if(!(indices = malloc(icount * sizeof(s32))))
+                return luaL_error(lua, "mesh: not enough memory\n");
+
+            for(s32 i = 0; i < icount; i++)
+            {
+                lua_rawgeti(lua, 2, i + 1);
+                indices[i] = getLuaNumber(lua, -1) - 1;
+                lua_pop(lua, 1);
+            }
+        }
+
+        float* vertices = NULL;
+        s32 vcount = 0;
+
+        if(lua_istable(lua, 1))
+        {
+            vcount = (s32)lua_rawlen(lua, 1) / stride;
+
+            if(vcount == 0 || !(vertices = malloc(vcount * stride * sizeof(float))))
+            {
+                free(indices);
+                return vcount ? luaL_error(lua, "mesh: not enough memory\n") : 0;
+            }
+
+            for(s32 i = 0; i < vcount * stride; i++)
+            {
+                lua_rawgeti(lua, 1, i + 1);
+                vertices[i] = (float)lua_tonumber(lua, -1);
+                lua_pop(lua, 1);
+            }
+        }
+        else if(indices && !(vertices = tic_core_mesh_ram(tic, getLuaNumber(lua, 1), stride, indices, icount, &vcount)))
+        {
+            free(indices);
+            return luaL_error(lua, "mesh: not enough memory\n");
+        }
+
+        tic_api_mesh(tic, vertices, vcount, indices, icount, color, use_map, colors, count, cull);
+
+        free(vertices);
+        free(indices);
+    }
+    else luaL_error(lua, "invalid parameters, mesh(vertices,[indices],[color=-1],[use_map=false],[chroma=off],[cull=false])\n");
+
+    return 0;
+}
 
 static s32 lua_clip(lua_State* lua)
 {
@@ -578,6 +681,63 @@ static void remapCallback(void* data, s32 x, s32 y, RemapResult* result)
     result->rotate = getLuaNumber(lua, -1);
 }
 
+// remap(ids, x, y, w, h) gets the visible cells as a row-major array and returns
+// [ids], [flips], [rotates] arrays, ids can also be modified in place
+static void remapBatchCallback(void* data, s32 x, s32 y, s32 w, s32 h, RemapResult* cells)
+{
+    RemapData* remap = (RemapData*)data;
+    lua_State* lua = remap->lua;
+    const s32 count = w * h;
+
+    lua_createtable(lua, count, 0);
+    s32 ids = lua_gettop(lua);
+
+    for(s32 i = 0; i < count; i++)
+    {
+        lua_pushinteger(lua, cells[i].index);
+        lua_rawseti(lua, ids, i + 1);
+    }
+
+    lua_rawgeti(lua, LUA_REGISTRYINDEX, remap->reg);
+    lua_pushvalue(lua, ids);
+    lua_pushinteger(lua, x);
+    lua_pushinteger(lua, y);
+    lua_pushinteger(lua, w);
+    lua_pushinteger(lua, h);
+
+    if(lua_pcall(lua, 5, 3, 0) == LUA_OK)
+    {
+        s32 top = lua_gettop(lua);
+        s32 src = lua_istable(lua, top - 2) ? top - 2 : ids;
+        s32 flips = lua_istable(lua, top - 1) ? top - 1 : 0;
+        s32 rotates = lua_istable(lua, top) ? top : 0;
+
+        for(s32 i = 0; i < count; i++)
+        {
+            RemapResult* cell = &cells[i];
+
+            lua_rawgeti(lua, src, i + 1);
+            cell->index = getLuaNumber(lua, -1);
+
+            if(flips)
+            {
+                lua_rawgeti(lua, flips, i + 1);
+                cell->flip = getLuaNumber(lua, -1);
+            }
+
+            if(rotates)
+            {
+                lua_rawgeti(lua, rotates, i + 1);
+                cell->rotate = getLuaNumber(lua, -1);
+            }
+
+            lua_settop(lua, top);
+        }
+    }
+
+    lua_settop(lua, ids - 1);
+}
+
 static s32 lua_map(lua_State* lua)
 {
     s32 x = 0;
@@ -641,13 +801,17 @@ static s32 lua_map(lua_State* lua)
                         {
                             if (lua_isfunction(lua, 9))
                             {
+                                lua_pushvalue(lua, 9);
                                 s32 remap = luaL_ref(lua, LUA_REGISTRYINDEX);
 
                                 RemapData data = {lua, remap};
 
                                 tic_mem* tic = (tic_mem*)getLuaCore(lua);
 
-                                tic_api_map(tic, x, y, w, h, sx, sy, colors, count, scale, remapCallback, &data);
+                                if(top >= 10 && lua_toboolean(lua, 10))
+                                    tic_core_map_batch(tic, x, y, w, h, sx, sy, colors, count, scale, remapBatchCallback, &data);
+                                else
+                                    tic_api_map(tic, x, y, w, h, sx, sy, colors, count, scale, remapCallback, &data);
 
                                 luaL_unref(lua, LUA_REGISTRYINDEX, data.reg);
 
@@ -1269,19 +1433,29 @@ static void lua_open_builtins(lua_State *lua)
 
 static void checkForceExit(lua_State *lua, lua_Debug *luadebug)
 {
-    tic_core* core = getLuaCore(lua);
+    const char* error = tic_core_budget_charge((tic_mem*)getLuaCore(lua), lua_gethookcount(lua));
 
-    tic_tick_data* tick = core->data;
+    if(error)
+    {
+        // the error is raised again on every instruction, so a pcall in the
+        // script unwinds to the next frame out instead of spinning,
+        // the next tick sets the step back
+        lua_sethook(lua, &checkForceExit, LUA_MASKCOUNT, 1);
+        luaL_error(lua, "%s", error);
+    }
+}
 
-    if(tick->forceExit && tick->forceExit(tick->data))
-        luaL_error(lua, "script execution was interrupted");
+// fine steps only when the budget is set, otherwise the hook just polls the host
+static void setLuaHook(tic_core* core)
+{
+    s32 step = core->data && core->data->budget ? TIC_BUDGET_STEP : TIC_POLL_STEP;
+
+    if(lua_gethookcount(core->lua) != step)
+        lua_sethook(core->lua, &checkForceExit, LUA_MASKCOUNT, step);
 }
 
 static void initAPI(tic_core* core)
 {
-    lua_pushlightuserdata(core->lua, core);
-    lua_setglobal(core->lua, TicCore);
-
 #define API_FUNC_DEF(name, ...) {lua_ ## name, #name},
     static const struct{lua_CFunction func; const char* name;} ApiItems[] = {TIC_API_LIST(API_FUNC_DEF)};
 #undef API_FUNC_DEF
@@ -1292,7 +1466,35 @@ static void initAPI(tic_core* core)
     registerLuaFunction(core, lua_dofile, "dofile");
     registerLuaFunction(core, lua_loadfile, "loadfile");
 
-    lua_sethook(core->lua, &checkForceExit, LUA_MASKCOUNT, LUA_LOC_STACK);
+    setLuaHook(core);
+}
+
+static void* allocLua(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    return tic_core_realloc(ud, ptr, nsize);
+}
+
+static s32 panicLua(lua_State* lua)
+{
+    fprintf(stderr, "PANIC: unprotected error in call to Lua API (%s)\n", lua_tostring(lua, -1));
+    return 0;
+}
+
+static lua_State* newLuaState(tic_core* core)
+{
+    tic_core_alloc_acquire((tic_mem*)core);
+
+    lua_State* lua = lua_newstate(allocLua, core);
+
+    if(lua)
+    {
+        *(tic_core**)lua_getextraspace(lua) = core;
+        lua_atpanic(lua, panicLua);
+    }
+    else
+        tic_core_alloc_release((tic_mem*)core);
+
+    return lua;
 }
 
 static void closeLua(tic_mem* tic)
@@ -1303,7 +1505,211 @@ static void closeLua(tic_mem* tic)
     {
         lua_close(core->lua);
         core->lua = NULL;
+
+        tic_core_alloc_release(tic);
+    }
+
+    core->callback.tic = core->callback.scn = core->callback.scanline = core->callback.ovr = LUA_NOREF;
+}
+
+// compiled chunks are kept in the core across restarts and reset() and can be
+// persisted by the host through the cacheLoad/cacheSave tick callbacks,
+// every chunk starts with the md5 of its dump, since Lua loads bytecode
+// without verifying it and a torn or foreign file must not be run
+
+typedef struct
+{
+    u8* data;
+    s32 size;
+} ChunkBuffer;
+
+typedef bool(*ChunkCompiler)(lua_State* lua, const char* code);
+
+static void chunkHash(const char* lang, const char* code, u8* hash)
+{
+    MD5_CTX ctx;
+    MD5_Init(&ctx);
+    MD5_Update(&ctx, lang, strlen(lang) + 1);
+    MD5_Update(&ctx, code, strlen(code));
+    MD5_Final(hash, &ctx);
+}
+
+static void dumpHash(const u8* data, s32 size, u8* hash)
+{
+    MD5_CTX ctx;
+    MD5_Init(&ctx);
+    MD5_Update(&ctx, data, size);
+    MD5_Final(hash, &ctx);
+}
+
+static bool checkChunk(const u8* data, s32 size)
+{
+    u8 hash[TIC_CHUNK_HASH_SIZE];
+
+    if(size <= TIC_CHUNK_HASH_SIZE)
+        return false;
+
+    dumpHash(data + TIC_CHUNK_HASH_SIZE, size - TIC_CHUNK_HASH_SIZE, hash);
+
+    return memcmp(data, hash, TIC_CHUNK_HASH_SIZE) == 0;
+}
+
+static void chunkKey(const u8* hash, char* key)
+{
+    for(s32 i = 0; i < TIC_CHUNK_HASH_SIZE; i++)
+        sprintf(key + i * 2, "%02x", hash[i]);
+}
+
+static tic_core_chunk* storeChunk(tic_core* core, const u8* hash, u8* data, s32 size)
+{
+    tic_core_chunk* item = &core->chunks.items[0];
+
+    // replace the least recently used one
+    for(s32 i = 1; i < TIC_CHUNK_CACHE_SIZE; i++)
+        if(core->chunks.items[i].used < item->used)
+            item = &core->chunks.items[i];
+
+    free(item->data);
+
+    memcpy(item->hash, hash, TIC_CHUNK_HASH_SIZE);
+    item->data = data;
+    item->size = size;
+    item->used = ++core->chunks.time;
+
+    return item;
+}
+
+static tic_core_chunk* findChunk(tic_core* core, const u8* hash)
+{
+    for(s32 i = 0; i < TIC_CHUNK_CACHE_SIZE; i++)
+    {
+        tic_core_chunk* item = &core->chunks.items[i];
+
+        if(item->data && memcmp(item->hash, hash, TIC_CHUNK_HASH_SIZE) == 0)
+        {
+            item->used = ++core->chunks.time;
+            return item;
+        }
+    }
+
+    if(core->data->cacheLoad)
+    {
+        char key[TIC_CHUNK_HASH_SIZE * 2 + 1];
+        chunkKey(hash, key);
+
+        s32 size = 0;
+        u8* data = core->data->cacheLoad(core->data->data, key, &size);
+
+        if(data)
+        {
+            if(checkChunk(data, size))
+                return storeChunk(core, hash, data, size);
+
+            free(data);
+        }
+    }
+
+    return NULL;
+}
+
+static s32 writeChunk(lua_State* lua, const void* data, size_t size, void* userdata)
+{
+    ChunkBuffer* buffer = userdata;
+    u8* ptr = realloc(buffer->data, buffer->size + size);
+
+    if(!ptr)
+        return 1;
+
+    memcpy(ptr + buffer->size, data, size);
+    buffer->data = ptr;
+    buffer->size += (s32)size;
+
+    return 0;
+}
+
+// pushes the compiled chunk or the error message
+static bool loadChunk(tic_core* core, const char* lang, const char* code, ChunkCompiler compile)
+{
+    lua_State* lua = core->lua;
+
+    u8 hash[TIC_CHUNK_HASH_SIZE];
+    chunkHash(lang, code, hash);
+
+    tic_core_chunk* item = findChunk(core, hash);
+
+    if(item)
+    {
+        // binary only, the chunk name is stored in the dump, so errors read the same
+        if(luaL_loadbufferx(lua, (const char*)item->data + TIC_CHUNK_HASH_SIZE,
+            item->size - TIC_CHUNK_HASH_SIZE, lang, "b") == LUA_OK)
+            return true;
+
+        // stale dump from another Lua build, compile it again
+        lua_pop(lua, 1);
+        free(item->data);
+        memset(item, 0, sizeof(tic_core_chunk));
     }
+
+    if(!compile(lua, code))
+        return false;
+
+    // room for the hash in front of the dump
+    ChunkBuffer buffer = {calloc(1, TIC_CHUNK_HASH_SIZE), TIC_CHUNK_HASH_SIZE};
+
+    if(buffer.data && lua_dump(lua, writeChunk, &buffer, 0) == 0 && buffer.size > TIC_CHUNK_HASH_SIZE)
+    {
+        dumpHash(buffer.data + TIC_CHUNK_HASH_SIZE, buffer.size - TIC_CHUNK_HASH_SIZE, buffer.data);
+
+        storeChunk(core, hash, buffer.data, buffer.size);
+
+        if(core->data->cacheSave)
+        {
+            char key[TIC_CHUNK_HASH_SIZE * 2 + 1];
+            chunkKey(hash, key);
+            core->data->cacheSave(core->data->data, key, buffer.data, buffer.size);
+        }
+    }
+    else free(buffer.data);
+
+    return true;
+}
+
+// pushes the Lua code translated from the source or the error message
+typedef bool(*ChunkTranslator)(lua_State* compiler, const char* code);
+
+// translators run in their own state and only the Lua code they produce is
+// loaded into the cart VM, so it looks the same on a cache hit and a miss
+static bool translateChunk(lua_State* lua, const char* code, const char* chunkname, ChunkTranslator translate)
+{
+    lua_State* compiler = luaL_newstate();
+
+    if(!compiler)
+    {
+        lua_pushstring(lua, "not enough memory");
+        return false;
+    }
+
+    lua_open_builtins(compiler);
+
+    bool done = translate(compiler, code);
+
+    size_t size = 0;
+    const char* result = lua_tolstring(compiler, -1, &size);
+
+    if(!result)
+        lua_pushstring(lua, "compilation failed");
+    else if(done)
+        done = luaL_loadbuffer(lua, result, size, chunkname) == LUA_OK;
+    else lua_pushlstring(lua, result, size);
+
+    lua_close(compiler);
+
+    return done;
+}
+
+static bool compileLua(lua_State* lua, const char* code)
+{
+    return luaL_loadstring(lua, code) == LUA_OK;
 }
 
 static bool initLua(tic_mem* tic, const char* code)
@@ -1312,7 +1718,7 @@ static bool initLua(tic_mem* tic, const char* code)
 
     closeLua(tic);
 
-    lua_State* lua = core->lua = luaL_newstate();
+    lua_State* lua = core->lua = newLuaState(core);
     lua_open_builtins(lua);
 
     initAPI(core);
@@ -1322,7 +1728,7 @@ static bool initLua(tic_mem* tic, const char* code)
 
         lua_settop(lua, 0);
 
-        if(luaL_loadstring(lua, code) != LUA_OK || lua_pcall(lua, 0, LUA_MULTRET, 0) != LUA_OK)
+        if(!loadChunk(core, "lua", code, compileLua) || lua_pcall(lua, 0, LUA_MULTRET, 0) != LUA_OK)
         {
             core->data->error(core->data->data, lua_tostring(lua, -1));
             return false;
@@ -1367,6 +1773,52 @@ static s32 docall (lua_State *lua, s32 narg, s32 nres)
     return status;
 }
 
+// keeps the global function in a registry slot, the slot is reused
+// while the global stays a function and released once it's gone
+static void resolveLuaCallback(lua_State* lua, s32* ref, const char* name)
+{
+    lua_getglobal(lua, name);
+
+    if(lua_isfunction(lua, -1))
+    {
+        if(*ref == LUA_NOREF)
+            *ref = luaL_ref(lua, LUA_REGISTRYINDEX);
+        else
+            lua_rawseti(lua, LUA_REGISTRYINDEX, *ref);
+    }
+    else
+    {
+        lua_pop(lua, 1);
+        luaL_unref(lua, LUA_REGISTRYINDEX, *ref);
+        *ref = LUA_NOREF;
+    }
+}
+
+// the callbacks are reassigned by the cart mostly from TIC(),
+// so they are resolved once per frame instead of once per call
+static void resolveLuaCallbacks(tic_core* core)
+{
+    lua_State* lua = core->lua;
+
+    resolveLuaCallback(lua, &core->callback.tic, TIC_FN);
+    resolveLuaCallback(lua, &core->callback.scn, SCN_FN);
+    resolveLuaCallback(lua, &core->callback.scanline, "scanline");
+    resolveLuaCallback(lua, &core->callback.ovr, OVR_FN);
+}
+
+static void callLuaRef(tic_core* core, s32 ref, s32 nargs)
+{
+    lua_State* lua = core->lua;
+
+    lua_rawgeti(lua, LUA_REGISTRYINDEX, ref);
+    lua_insert(lua, -1 - nargs);
+
+    if(docall(lua, nargs, 0) != LUA_OK)
+        core->data->error(core->data->data, lua_tostring(lua, -1));
+    else if(tic_core_budget_aborted((tic_mem*)core))
+        core->data->error(core->data->data, tic_core_budget_aborted((tic_mem*)core));
+}
+
 static void callLuaTick(tic_mem* tic)
 {
     tic_core* core = (tic_core*)tic;
@@ -1375,64 +1827,85 @@ static void callLuaTick(tic_mem* tic)
 
     if(lua)
     {
-        lua_getglobal(lua, TIC_FN);
-        if(lua_isfunction(lua, -1)) 
+        // the host can change the budget between frames
+        setLuaHook(core);
+
+        if(core->callback.tic == LUA_NOREF)
+            resolveLuaCallbacks(core);
+
+        if(core->callback.tic != LUA_NOREF)
         {
-            if(docall(lua, 0, 0) != LUA_OK) 
-                core->data->error(core->data->data, lua_tostring(lua, -1));
-        }
-        else 
-        {       
-            lua_pop(lua, 1);
-            core->data->error(core->data->data, "'function TIC()...' isn't found :(");
+            callLuaRef(core, core->callback.tic, 0);
+
+            // the cart could be closed by the error handler
+            if(core->lua)
+                resolveLuaCallbacks(core);
         }
+        else core->data->error(core->data->data, "'function TIC()...' isn't found :(");
     }
 }
 
-static void callLuaScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static void callLuaScanlineRef(tic_core* core, s32 row, s32 ref)
 {
-    tic_core* core = (tic_core*)tic;
-    lua_State* lua = core->lua;
-
-    if (lua)
+    if(ref != LUA_NOREF)
     {
-        lua_getglobal(lua, name);
-        if(lua_isfunction(lua, -1))
-        {
-            lua_pushinteger(lua, row);
-            if(docall(lua, 1, 0) != LUA_OK)
-                core->data->error(core->data->data, lua_tostring(lua, -1));
-        }
-        else lua_pop(lua, 1);
+        lua_pushinteger(core->lua, row);
+        callLuaRef(core, ref, 1);
     }
 }
 
 static void callLuaScanline(tic_mem* tic, s32 row, void* data)
 {
-    callLuaScanlineName(tic, row, data, SCN_FN);
+    tic_core* core = (tic_core*)tic;
+
+    if(core->lua)
+    {
+        callLuaScanlineRef(core, row, core->callback.scn);
 
-    // try to call old scanline
-    callLuaScanlineName(tic, row, data, "scanline");
+        // try to call old scanline
+        callLuaScanlineRef(core, row, core->callback.scanline);
+    }
 }
 
 static void callLuaOverline(tic_mem* tic, void* data)
+{
+    tic_core* core = (tic_core*)tic;
+
+    if(core->lua && core->callback.ovr != LUA_NOREF)
+        callLuaRef(core, core->callback.ovr, 0);
+}
+
+// Lua 5.3 defaults (LUAI_GCPAUSE, LUAI_GCMUL) and the pause used while
+// the slices between frames keep up
+#define LUA_GC_PAUSE 200
+#define LUA_GC_STEPMUL 200
+#define LUA_GC_IDLE_PAUSE 400
+
+static void collectLua(tic_mem* tic, u64 deadline)
 {
     tic_core* core = (tic_core*)tic;
     lua_State* lua = core->lua;
 
-    if (lua)
+    if(lua)
     {
-        const char* OvrFunc = OVR_FN;
+        tic_tick_data* data = core->data;
+        bool done;
+
+        // the threshold for the next cycle is set with the pause when a cycle ends
+        lua_gc(lua, LUA_GCSETPAUSE, LUA_GC_IDLE_PAUSE);
 
-        lua_getglobal(lua, OvrFunc);
-        if(lua_isfunction(lua, -1)) 
+        // basic steps until the end of a cycle, the next one starts in the next frame
+        do done = lua_gc(lua, LUA_GCSTEP, 0);
+        while(!done && deadline && data->counter(data->data) < deadline);
+
+        // TIC() starts a cycle only on a large growth while the slices keep up,
+        // otherwise the collector gets its default pace back
+        if(!done)
         {
-            if(docall(lua, 0, 0) != LUA_OK)
-                core->data->error(core->data->data, lua_tostring(lua, -1));
+            lua_gc(lua, LUA_GCSETPAUSE, LUA_GC_PAUSE);
+            lua_gc(lua, LUA_GCSETSTEPMUL, LUA_GC_STEPMUL);
         }
-        else lua_pop(lua, 1);
     }
-
 }
 
 static const char* const LuaKeywords [] =
@@ -1526,6 +1999,7 @@ static const tic_script_config LuaSyntaxConfig =
     .tick               = callLuaTick,
     .scanline           = callLuaScanline,
     .overline           = callLuaOverline,
+    .collect            = collectLua,
 
     .getOutline         = getLuaOutline,
     .eval               = evalLua,
@@ -1553,13 +2027,13 @@ const tic_script_config* getLuaScriptConfig()
 
 #define MOON_CODE(...) #__VA_ARGS__
 
-static const char* execute_moonscript_src = MOON_CODE(
-    local fn, err = require('moonscript.base').loadstring(...)
+static const char* compile_moonscript_src = MOON_CODE(
+    local code, err = require('moonscript.base').to_lua(...)
 
-    if not fn then
+    if not code then
         error(err)
     end
-    return fn()
+    return code
 );
 
 static void setloaded(lua_State* l, char* name)
@@ -1577,12 +2051,40 @@ static void setloaded(lua_State* l, char* name)
     lua_settop(l, top);
 }
 
+static bool translateMoonscript(lua_State* moon, const char* code)
+{
+    luaopen_lpeg(moon);
+    setloaded(moon, "lpeg");
+    lua_settop(moon, 0);
+
+    if (luaL_loadbuffer(moon, (const char *)moonscript_lua, moonscript_lua_len, "moonscript.lua") != LUA_OK
+        || lua_pcall(moon, 0, 0, 0) != LUA_OK)
+    {
+        lua_pushstring(moon, "failed to load moonscript.lua");
+        return false;
+    }
+
+    if (luaL_loadbuffer(moon, compile_moonscript_src, strlen(compile_moonscript_src), "compile_moonscript") != LUA_OK)
+    {
+        lua_pushstring(moon, "failed to load moonscript compiler");
+        return false;
+    }
+
+    lua_pushstring(moon, code);
+    return lua_pcall(moon, 1, 1, 0) == LUA_OK;
+}
+
+static bool compileMoonscript(lua_State* lua, const char* code)
+{
+    return translateChunk(lua, code, "=(moonscript.loadstring)", translateMoonscript);
+}
+
 static bool initMoonscript(tic_mem* tic, const char* code)
 {
     tic_core* core = (tic_core*)tic;
     closeLua(tic);
 
-    lua_State* lua = core->lua = luaL_newstate();
+    lua_State* lua = core->lua = newLuaState(core);
     lua_open_builtins(lua);
 
     luaopen_lpeg(lua);
@@ -1595,22 +2097,7 @@ static bool initMoonscript(tic_mem* tic, const char* code)
 
         lua_settop(moon, 0);
 
-        if (luaL_loadbuffer(moon, (const char *)moonscript_lua, moonscript_lua_len, "moonscript.lua") != LUA_OK)
-        {
-            core->data->error(core->data->data, "failed to load moonscript.lua");
-            return false;
-        }
-
-        lua_call(moon, 0, 0);
-
-        if (luaL_loadbuffer(moon, execute_moonscript_src, strlen(execute_moonscript_src), "execute_moonscript") != LUA_OK)
-        {
-            core->data->error(core->data->data, "failed to load moonscript compiler");
-            return false;
-        }
-
-        lua_pushstring(moon, code);
-        if (lua_pcall(moon, 1, 1, 0) != LUA_OK)
+        if (!loadChunk(core, "moon", code, compileMoonscript) || lua_pcall(moon, 0, 0, 0) != LUA_OK)
         {
             const char* msg = lua_tostring(moon, -1);
 
@@ -1693,6 +2180,7 @@ static const tic_script_config MoonSyntaxConfig =
     .tick               = callLuaTick,
     .scanline           = callLuaScanline,
     .overline           = callLuaOverline,
+    .collect            = collectLua,
 
     .getOutline         = getMoonOutline,
     .eval               = NULL,
@@ -1728,13 +2216,71 @@ static const char* execute_fennel_src = FENNEL_CODE(
   if(not ok) then return msg end
 );
 
+static const char* compile_fennel_src = FENNEL_CODE(
+  local opts = {filename="game", correlate=true, allowedGlobals=false}
+  return require('fennel').compileString(..., opts)
+);
+
+// the cart VM gets the compiler only when it's required, by the console
+// eval or by the cart itself, the loader registers package.loaded.fennel
+static s32 loadFennelModule(lua_State* lua)
+{
+    if (luaL_loadbuffer(lua, (const char *)loadfennel_lua,
+                        loadfennel_lua_len, "fennel.lua") != LUA_OK)
+        return lua_error(lua);
+
+    lua_call(lua, 0, 0);
+
+    lua_getglobal(lua, "package");
+    lua_getfield(lua, -1, "loaded");
+    lua_getfield(lua, -1, "fennel");
+
+    return 1;
+}
+
+static void preloadFennel(lua_State* lua)
+{
+    lua_getglobal(lua, "package");
+    lua_getfield(lua, -1, "preload");
+    lua_pushcfunction(lua, loadFennelModule);
+    lua_setfield(lua, -2, "fennel");
+    lua_pop(lua, 2);
+}
+
+// same options as fennel.eval
+static bool translateFennel(lua_State* fennel, const char* code)
+{
+    if (luaL_loadbuffer(fennel, (const char *)loadfennel_lua,
+                        loadfennel_lua_len, "fennel.lua") != LUA_OK
+        || lua_pcall(fennel, 0, 0, 0) != LUA_OK)
+    {
+        lua_pushstring(fennel, "failed to load fennel compiler");
+        return false;
+    }
+
+    if (luaL_loadbuffer(fennel, compile_fennel_src, strlen(compile_fennel_src), "compile_fennel") != LUA_OK)
+    {
+        lua_pushstring(fennel, "failed to load fennel compiler");
+        return false;
+    }
+
+    lua_pushstring(fennel, code);
+    return lua_pcall(fennel, 1, 1, 0) == LUA_OK;
+}
+
+static bool compileFennel(lua_State* lua, const char* code)
+{
+    return translateChunk(lua, code, "@game", translateFennel);
+}
+
 static bool initFennel(tic_mem* tic, const char* code)
 {
     tic_core* core = (tic_core*)tic;
     closeLua(tic);
 
-    lua_State* lua = core->lua = luaL_newstate();
+    lua_State* lua = core->lua = newLuaState(core);
     lua_open_builtins(lua);
+    preloadFennel(lua);
 
     initAPI(core);
 
@@ -1743,28 +2289,9 @@ static bool initFennel(tic_mem* tic, const char* code)
 
         lua_settop(fennel, 0);
 
-        if (luaL_loadbuffer(fennel, (const char *)loadfennel_lua,
-                            loadfennel_lua_len, "fennel.lua") != LUA_OK)
-        {
-            core->data->error(core->data->data, "failed to load fennel compiler");
-            return false;
-        }
-
-        lua_call(fennel, 0, 0);
-
-        if (luaL_loadbuffer(fennel, execute_fennel_src, strlen(execute_fennel_src), "execute_fennel") != LUA_OK)
-        {
-            core->data->error(core->data->data, "failed to load fennel compiler");
-            return false;
-        }
-
-        lua_pushstring(fennel, code);
-        lua_call(fennel, 1, 1);
-        const char* err = lua_tostring(fennel, -1);
-
-        if (err)
+        if (!loadChunk(core, "fennel", code, compileFennel) || lua_pcall(fennel, 0, 0, 0) != LUA_OK)
         {
-            core->data->error(core->data->data, err);
+            core->data->error(core->data->data, lua_tostring(fennel, -1));
             return false;
         }
     }
@@ -1849,10 +2376,12 @@ static void evalFennel(tic_mem* tic, const char* code) {
     if (luaL_loadbuffer(fennel, execute_fennel_src, strlen(execute_fennel_src), "execute_fennel") != LUA_OK)
     {
         core->data->error(core->data->data, "failed to load fennel compiler");
+        return;
     }
 
+    // require('fennel') runs outside of the pcall in the snippet
     lua_pushstring(fennel, code);
-    lua_call(fennel, 1, 1);
+    lua_pcall(fennel, 1, 1, 0);
     const char* err = lua_tostring(fennel, -1);
 
     if (err)
@@ -1869,6 +2398,7 @@ static const tic_script_config FennelSyntaxConfig =
     .tick               = callLuaTick,
     .scanline           = callLuaScanline,
     .overline           = callLuaOverline,
+    .collect            = collectLua,
 
     .getOutline         = getFennelOutline,
     .eval               = evalFennel,
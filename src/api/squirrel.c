@@ -403,12 +403,131 @@ static SQInteger squirrel_textri(HSQUIRRELVM vm)
                                     pt[8], pt[9],   //  uv 2
                                     pt[10], pt[11], //  uv 3
                                     use_map,        // use map
-                                    colors, count);        // chroma
+                                    colors, count,  // chroma
+                                    0, 0, 0, false); // perspective
     }
     else return sq_throwerror(vm, "invalid parameters, textri(x1,y1,x2,y2,x3,y3,u1,v1,u2,v2,u3,v3,[use_map=false],[chroma=off])\n");
     return 0;
 }
 
+static SQInteger squirrel_mesh(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+    SQObjectType type = top >= 2 ? sq_gettype(vm, 2) : OT_NULL;
+
+    if (type == OT_ARRAY || type & (OT_FLOAT|OT_INTEGER))
+    {
+        tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+        static u8 colors[TIC_PALETTE_SIZE];
+        s32 count = 0;
+
+        s32 color = top >= 4 && sq_gettype(vm, 4) != OT_NULL ? getSquirrelNumber(vm, 4) : -1;
+        bool use_map = false, cull = false;
+        const s32 stride = color < 0 ? 4 : 2;
+
+        if (top >= 5)
+        {
+            SQBool b = SQFalse;
+            sq_getbool(vm, 5, &b);
+            use_map = (b != SQFalse);
+        }
+
+        if (top >= 7)
+        {
+            SQBool b = SQFalse;
+            sq_getbool(vm, 7, &b);
+            cull = (b != SQFalse);
+        }
+
+        //  check for chroma 
+        if (top >= 6)
+        {
+            if(OT_ARRAY == sq_gettype(vm, 6))
+            {
+                for(s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+                {
+                    sq_pushinteger(vm, (SQInteger)i);
+                    if(SQ_FAILED(sq_rawget(vm, 6)))
+                        break;
+
+                    bool number = sq_gettype(vm, -1) & (OT_FLOAT|OT_INTEGER);
+
+                    if(number)
+                        colors[count++] = getSquirrelNumber(vm, -1);
+
+                    sq_poptop(vm);
+
+                    if(!number) break;
+                }
+            }
+            else if(sq_gettype(vm, 6) != OT_NULL)
+            {
+                colors[0] = getSquirrelNumber(vm, 6);
+                count = 1;
+            }
+        }
+
+        s32* indices = NULL;
+        s32 icount = 0;
+
+        if (top >= 3 && sq_gettype(vm, 3) == OT_ARRAY)
+        {
+            icount = (s32)sq_getsize(vm, 3);
+
+            // an empty index list draws nothing
+            if (icount == 0)
+                return 0;
+
+            if (!(indices = malloc(icount * sizeof(s32))))
+                return sq_throwerror(vm, "mesh: not enough memory\n");
+
+            for (s32 i = 0; i < icount; i++)
+            {
+                sq_pushinteger(vm, (SQInteger)i);
+                sq_rawget(vm, 3);
+                indices[i] = getSquirrelNumber(vm, -1);
+                sq_poptop(vm);
+            }
+        }
+
+        float* vertices = NULL;
+        s32 vcount = 0;
+
+        if (type == OT_ARRAY)
+        {
+            vcount = (s32)sq_getsize(vm, 2) / stride;
+
+            if (vcount == 0 || !(vertices = malloc(vcount * stride * sizeof(float))))
+            {
+                free(indices);
+                return vcount ? sq_throwerror(vm, "mesh: not enough memory\n") : 0;
+            }
+
+            for (s32 i = 0; i < vcount * stride; i++)
+            {
+                SQFloat f = 0.0;
+                sq_pushinteger(vm, (SQInteger)i);
+                sq_rawget(vm, 2);
+                sq_getfloat(vm, -1, &f);
+                vertices[i] = (float)f;
+                sq_poptop(vm);
+            }
+        }
+        else if (indices && !(vertices = tic_core_mesh_ram(tic, getSquirrelNumber(vm, 2), stride, indices, icount, &vcount)))
+        {
+            free(indices);
+            return sq_throwerror(vm, "mesh: not enough memory\n");
+        }
+
+        tic_api_mesh(tic, vertices, vcount, indices, icount, color, use_map, colors, count, cull);
+
+        free(vertices);
+        free(indices);
+    }
+    else return sq_throwerror(vm, "invalid parameters, mesh(vertices,[indices],[color=-1],[use_map=false],[chroma=off],[cull=false])\n");
+
+    return 0;
+}
 
 static SQInteger squirrel_clip(HSQUIRRELVM vm)
 {
@@ -1367,11 +1486,11 @@ static void squirrel_open_builtins(HSQUIRRELVM vm)
 
 static void checkForceExit(HSQUIRRELVM vm, SQInteger type, const SQChar* sourceName, SQInteger line, const SQChar* functionName)
 {
-    tic_core* core = getSquirrelCore(vm);
-    tic_tick_data* tick = core->data;
+    // every line, call and return is charged as one instruction
+    const char* error = tic_core_budget_charge((tic_mem*)getSquirrelCore(vm), 1);
 
-    if(tick && tick->forceExit && tick->forceExit(tick->data))
-        sq_throwerror(vm, "script execution was interrupted");
+    if(error)
+        sq_throwerror(vm, error);
 }
 
 static void initAPI(tic_core* core)
@@ -1427,6 +1546,8 @@ static bool initSquirrel(tic_mem* tic, const char* code)
     HSQUIRRELVM vm = core->squirrel = sq_open(100);
     squirrel_open_builtins(vm);
 
+    core->callback.tic = core->callback.scn = core->callback.scanline = core->callback.ovr = false;
+
     sq_newclosure(vm, squirrel_errorHandler, 0);
     sq_seterrorhandler(vm);
 
@@ -1458,77 +1579,119 @@ static bool initSquirrel(tic_mem* tic, const char* code)
     return true;
 }
 
-static void callSquirrelTick(tic_mem* tic)
+enum {SquirrelTic, SquirrelScn, SquirrelScanline, SquirrelOvr};
+
+// the callbacks are kept in the registry table by index and resolved
+// once per frame instead of looking up the root table on every call
+static void resolveSquirrelCallback(HSQUIRRELVM vm, s32* present, SQInteger index, const char* name)
 {
-    tic_core* core = (tic_core*)tic;
+    sq_pushregistrytable(vm);
+    sq_pushinteger(vm, index);
+    sq_pushroottable(vm);
+    sq_pushstring(vm, name, -1);
+
+    *present = false;
+
+    if(SQ_SUCCEEDED(sq_get(vm, -2)))
+    {
+        SQObjectType type = sq_gettype(vm, -1);
+        *present = type == OT_CLOSURE || type == OT_NATIVECLOSURE;
+    }
+    else sq_pushnull(vm);
 
+    sq_remove(vm, -2); // root table
+    sq_rawset(vm, -3);
+    sq_poptop(vm); // registry table
+}
+
+static void resolveSquirrelCallbacks(tic_core* core)
+{
     HSQUIRRELVM vm = core->squirrel;
 
-    if(vm)
+    resolveSquirrelCallback(vm, &core->callback.tic, SquirrelTic, TIC_FN);
+    resolveSquirrelCallback(vm, &core->callback.scn, SquirrelScn, SCN_FN);
+    resolveSquirrelCallback(vm, &core->callback.scanline, SquirrelScanline, "scanline");
+    resolveSquirrelCallback(vm, &core->callback.ovr, SquirrelOvr, OVR_FN);
+}
+
+static void pushSquirrelCallback(HSQUIRRELVM vm, SQInteger index)
+{
+    sq_pushregistrytable(vm);
+    sq_pushinteger(vm, index);
+    sq_rawget(vm, -2);
+    sq_remove(vm, -2); // registry table
+}
+
+// calls the closure pushed under the root table and params
+// and pops it, reporting the error if any
+static void callSquirrelCallback(tic_core* core, SQInteger params)
+{
+    HSQUIRRELVM vm = core->squirrel;
+
+    if(SQ_FAILED(sq_call(vm, params + 1, SQFalse, SQTrue)))
     {
-        sq_pushroottable(vm);
-        sq_pushstring(vm, TIC_FN, -1);
+        sq_getlasterror(vm);
+        sq_tostring(vm, -1);
 
-        if (SQ_SUCCEEDED(sq_get(vm, -2)))
-        {
-            sq_pushroottable(vm);
-            if(SQ_FAILED(sq_call(vm, 1, SQFalse, SQTrue)))
-            {
-                sq_getlasterror(vm);
-                sq_tostring(vm, -1);
-                const SQChar* errorString = "unknown error";
-                sq_getstring(vm, -1, &errorString);
-
-                if (core->data)
-                    core->data->error(core->data->data, errorString);
-                sq_pop(vm, 3); // remove string, error and root table.
-            }
-        }
-        else 
-        {       
-            sq_pop(vm, 1);
-            if (core->data)
-                core->data->error(core->data->data, "'function TIC()...' isn't found :(");
-        }
+        const SQChar* errorString = "unknown error";
+        sq_getstring(vm, -1, &errorString);
+        if (core->data)
+            core->data->error(core->data->data, errorString);
+        sq_pop(vm, 2); // error string and error
     }
+    else if(core->data && tic_core_budget_aborted((tic_mem*)core))
+        core->data->error(core->data->data, tic_core_budget_aborted((tic_mem*)core));
+
+    sq_poptop(vm); // closure
 }
 
-static void callSquirrelScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static void callSquirrelTick(tic_mem* tic)
 {
     tic_core* core = (tic_core*)tic;
+
     HSQUIRRELVM vm = core->squirrel;
 
-    if (vm)
+    if(vm)
     {
-        sq_pushroottable(vm);
-        sq_pushstring(vm, name, -1);
-        if (SQ_SUCCEEDED(sq_get(vm, -2)))
+        if(!core->callback.tic)
+            resolveSquirrelCallbacks(core);
+
+        if(core->callback.tic)
         {
+            pushSquirrelCallback(vm, SquirrelTic);
             sq_pushroottable(vm);
-            sq_pushinteger(vm, row);
+            callSquirrelCallback(core, 0);
 
-            if(SQ_FAILED(sq_call(vm, 2, SQFalse, SQTrue)))
-            {
-                sq_getlasterror(vm);
-                sq_tostring(vm, -1);
-
-                const SQChar* errorString = "unknown error";
-                sq_getstring(vm, -1, &errorString);
-                if (core->data)
-                    core->data->error(core->data->data, errorString);
-                sq_pop(vm, 3); // error string, error and root table
-            }
+            resolveSquirrelCallbacks(core);
         }
-        else sq_poptop(vm);
+        else if (core->data)
+            core->data->error(core->data->data, "'function TIC()...' isn't found :(");
     }
 }
 
+static void callSquirrelScanlineIndex(tic_core* core, s32 row, SQInteger index)
+{
+    HSQUIRRELVM vm = core->squirrel;
+
+    pushSquirrelCallback(vm, index);
+    sq_pushroottable(vm);
+    sq_pushinteger(vm, row);
+    callSquirrelCallback(core, 1);
+}
+
 static void callSquirrelScanline(tic_mem* tic, s32 row, void* data)
 {
-    callSquirrelScanlineName(tic, row, data, SCN_FN);
+    tic_core* core = (tic_core*)tic;
+
+    if (core->squirrel)
+    {
+        if(core->callback.scn)
+            callSquirrelScanlineIndex(core, row, SquirrelScn);
 
-    // try to call old scanline
-    callSquirrelScanlineName(tic, row, data, "scanline");
+        // try to call old scanline
+        if(core->callback.scanline)
+            callSquirrelScanlineIndex(core, row, SquirrelScanline);
+    }
 }
 
 static void callSquirrelOverline(tic_mem* tic, void* data)
@@ -1536,30 +1699,12 @@ static void callSquirrelOverline(tic_mem* tic, void* data)
     tic_core* core = (tic_core*)tic;
     HSQUIRRELVM vm = core->squirrel;
 
-    if (vm)
+    if (vm && core->callback.ovr)
     {
-        const char* OvrFunc = OVR_FN;
-
+        pushSquirrelCallback(vm, SquirrelOvr);
         sq_pushroottable(vm);
-        sq_pushstring(vm, OvrFunc, -1);
-        
-        if(SQ_SUCCEEDED(sq_get(vm, -2))) 
-        {
-            sq_pushroottable(vm);
-            if(SQ_FAILED(sq_call(vm, 1, SQFalse, SQTrue)))
-            {
-                sq_getlasterror(vm);
-                sq_tostring(vm, -1);
-                const SQChar* errorString = "unknown error";
-                sq_getstring(vm, -1, &errorString);
-                if (core->data)
-                    core->data->error(core->data->data, errorString);
-                sq_pop(vm, 3);
-            }
-        }
-        else sq_poptop(vm);
+        callSquirrelCallback(core, 0);
     }
-
 }
 
 static const char* const SquirrelKeywords [] =
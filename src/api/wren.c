@@ -73,6 +73,12 @@ class TIC {\n\
     foreign static textri(x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3)\n\
     foreign static textri(x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, use_map)\n\
     foreign static textri(x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, use_map, alpha_color)\n\
+    foreign static mesh(vertices)\n\
+    foreign static mesh(vertices, indices)\n\
+    foreign static mesh(vertices, indices, color)\n\
+    foreign static mesh(vertices, indices, color, use_map)\n\
+    foreign static mesh(vertices, indices, color, use_map, alpha_color)\n\
+    foreign static mesh(vertices, indices, color, use_map, alpha_color, cull)\n\
     foreign static pix(x, y)\n\
     foreign static pix(x, y, color)\n\
     foreign static line(x0, y0, x1, y1, color)\n\
@@ -764,7 +770,110 @@ static void wren_textri(WrenVM* vm)
                                 pt[8], pt[9],   //  uv 2
                                 pt[10], pt[11], //  uv 3
                                 use_map,        // use map
-                                colors, count);        // chroma
+                                colors, count,  // chroma
+                                0, 0, 0, false); // perspective
+}
+
+static void wren_mesh(WrenVM* vm)
+{
+    int top = wrenGetSlotCount(vm);
+
+    if (!isList(vm, 1) && !isNumber(vm, 1))
+    {
+        wrenError(vm, "invalid parameters, mesh(vertices,[indices],[color=-1],[use_map=false],[alpha_color=off],[cull=false])\n");
+        return;
+    }
+
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+    static u8 colors[TIC_PALETTE_SIZE];
+    s32 count = 0;
+
+    s32 color = top > 3 && isNumber(vm, 3) ? getWrenNumber(vm, 3) : -1;
+    bool use_map = top > 4 && wrenGetSlotType(vm, 4) == WREN_TYPE_BOOL && wrenGetSlotBool(vm, 4);
+    bool cull = top > 6 && wrenGetSlotType(vm, 6) == WREN_TYPE_BOOL && wrenGetSlotBool(vm, 6);
+    const s32 stride = color < 0 ? 4 : 2;
+
+    wrenEnsureSlots(vm, top + 1);
+
+    //  check for chroma 
+    if (top > 5)
+    {
+        if(isList(vm, 5))
+        {
+            int list_count = wrenGetListCount(vm, 5);
+            for(s32 i = 0; i < TIC_PALETTE_SIZE && i < list_count; i++)
+            {
+                wrenGetListElement(vm, 5, i, top);
+                if(!isNumber(vm, top))
+                    break;
+
+                colors[count++] = getWrenNumber(vm, top);
+            }
+        }
+        else if(isNumber(vm, 5))
+        {
+            colors[0] = getWrenNumber(vm, 5);
+            count = 1;
+        }
+    }
+
+    s32* indices = NULL;
+    s32 icount = 0;
+
+    if (top > 2 && isList(vm, 2))
+    {
+        icount = wrenGetListCount(vm, 2);
+
+        // an empty index list draws nothing
+        if (icount == 0)
+            return;
+
+        if (!(indices = malloc(icount * sizeof(s32))))
+        {
+            wrenError(vm, "mesh: not enough memory\n");
+            return;
+        }
+
+        for (s32 i = 0; i < icount; i++)
+        {
+            wrenGetListElement(vm, 2, i, top);
+            indices[i] = isNumber(vm, top) ? getWrenNumber(vm, top) : -1;
+        }
+    }
+
+    float* vertices = NULL;
+    s32 vcount = 0;
+
+    if (isList(vm, 1))
+    {
+        vcount = wrenGetListCount(vm, 1) / stride;
+
+        if (vcount == 0 || !(vertices = malloc(vcount * stride * sizeof(float))))
+        {
+            if (vcount)
+                wrenError(vm, "mesh: not enough memory\n");
+
+            free(indices);
+            return;
+        }
+
+        for (s32 i = 0; i < vcount * stride; i++)
+        {
+            wrenGetListElement(vm, 1, i, top);
+            vertices[i] = isNumber(vm, top) ? (float)wrenGetSlotDouble(vm, top) : 0;
+        }
+    }
+    else if (indices && !(vertices = tic_core_mesh_ram(tic, getWrenNumber(vm, 1), stride, indices, icount, &vcount)))
+    {
+        wrenError(vm, "mesh: not enough memory\n");
+        free(indices);
+        return;
+    }
+
+    tic_api_mesh(tic, vertices, vcount, indices, icount, color, use_map, colors, count, cull);
+
+    free(vertices);
+    free(indices);
 }
 
 static void wren_pix(WrenVM* vm)
@@ -1251,6 +1360,13 @@ static WrenForeignMethodFn foreignTicMethods(const char* signature)
     if (strcmp(signature, "static TIC.textri(_,_,_,_,_,_,_,_,_,_,_,_,_)"     ) == 0) return wren_textri;
     if (strcmp(signature, "static TIC.textri(_,_,_,_,_,_,_,_,_,_,_,_,_,_)"   ) == 0) return wren_textri;
 
+    if (strcmp(signature, "static TIC.mesh(_)"                  ) == 0) return wren_mesh;
+    if (strcmp(signature, "static TIC.mesh(_,_)"                ) == 0) return wren_mesh;
+    if (strcmp(signature, "static TIC.mesh(_,_,_)"              ) == 0) return wren_mesh;
+    if (strcmp(signature, "static TIC.mesh(_,_,_,_)"            ) == 0) return wren_mesh;
+    if (strcmp(signature, "static TIC.mesh(_,_,_,_,_)"          ) == 0) return wren_mesh;
+    if (strcmp(signature, "static TIC.mesh(_,_,_,_,_,_)"        ) == 0) return wren_mesh;
+
     if (strcmp(signature, "static TIC.pix(_,_)"                 ) == 0) return wren_pix;
     if (strcmp(signature, "static TIC.pix(_,_,_)"               ) == 0) return wren_pix;
     if (strcmp(signature, "static TIC.line(_,_,_,_,_)"          ) == 0) return wren_line;
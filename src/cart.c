@@ -24,28 +24,8 @@
 #include "tools.h"
 #include <string.h>
 #include <stdlib.h>
-
-typedef enum
-{
-    CHUNK_DUMMY,        // 0
-    CHUNK_TILES,        // 1
-    CHUNK_SPRITES,      // 2
-    CHUNK_COVER,        // 3
-    CHUNK_MAP,          // 4
-    CHUNK_CODE,         // 5
-    CHUNK_FLAGS,        // 6
-    CHUNK_TEMP2,        // 7
-    CHUNK_TEMP3,        // 8
-    CHUNK_SAMPLES,      // 9
-    CHUNK_WAVEFORM,     // 10
-    CHUNK_TEMP4,        // 11
-    CHUNK_PALETTE,      // 12
-    CHUNK_PATTERNS_DEP, // 13 - deprecated chunk
-    CHUNK_MUSIC,        // 14
-    CHUNK_PATTERNS,     // 15
-    CHUNK_CODE_ZIP,     // 16
-    CHUNK_DEFAULT,      // 17
-} ChunkType;
+#include <stdint.h>
+#include <zlib.h>
 
 typedef struct
 {
@@ -60,6 +40,51 @@ STATIC_ASSERT(tic_chunk_size, sizeof(Chunk) == 4);
 static const u8 Sweetie16[] = {0x1a, 0x1c, 0x2c, 0x5d, 0x27, 0x5d, 0xb1, 0x3e, 0x53, 0xef, 0x7d, 0x57, 0xff, 0xcd, 0x75, 0xa7, 0xf0, 0x70, 0x38, 0xb7, 0x64, 0x25, 0x71, 0x79, 0x29, 0x36, 0x6f, 0x3b, 0x5d, 0xc9, 0x41, 0xa6, 0xf6, 0x73, 0xef, 0xf7, 0xf4, 0xf4, 0xf4, 0x94, 0xb0, 0xc2, 0x56, 0x6c, 0x86, 0x33, 0x3c, 0x57};
 static const u8 Waveforms[] = {0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0xef, 0xcd, 0xab, 0x89, 0x67, 0x45, 0x23, 0x01, 0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe};
 
+static const u8 DB16[] = {0x14, 0x0c, 0x1c, 0x44, 0x24, 0x34, 0x30, 0x34, 0x6d, 0x4e, 0x4a, 0x4e, 0x85, 0x4c, 0x30, 0x34, 0x65, 0x24, 0xd0, 0x46, 0x48, 0x75, 0x71, 0x61, 0x59, 0x7d, 0xce, 0xd2, 0x7d, 0x2c, 0x85, 0x95, 0xa1, 0x6d, 0xaa, 0x2c, 0xd2, 0xaa, 0x99, 0x6d, 0xc2, 0xca, 0xda, 0xd4, 0x5e, 0xde, 0xee, 0xd6};
+
+static void loadBankChunk(tic_bank* bank, ChunkType type, const u8* buffer, s32 size)
+{
+    #define LOAD_CHUNK(to) memcpy(&to, buffer, MIN(sizeof(to), size))
+
+    switch(type)
+    {
+    case CHUNK_TILES:       LOAD_CHUNK(bank->tiles);          break;
+    case CHUNK_SPRITES:     LOAD_CHUNK(bank->sprites);        break;
+    case CHUNK_MAP:         LOAD_CHUNK(bank->map);            break;
+    case CHUNK_SAMPLES:     LOAD_CHUNK(bank->sfx.samples);    break;
+    case CHUNK_WAVEFORM:    LOAD_CHUNK(bank->sfx.waveforms);  break;
+    case CHUNK_MUSIC:       LOAD_CHUNK(bank->music.tracks);   break;
+    case CHUNK_PATTERNS:    LOAD_CHUNK(bank->music.patterns); break;
+    case CHUNK_PALETTE:     LOAD_CHUNK(bank->palette);        break;
+    case CHUNK_FLAGS:       LOAD_CHUNK(bank->flags);          break;
+    case CHUNK_PATTERNS_DEP: 
+        {
+            // workaround to load deprecated music patterns section
+            // and automatically convert volume value to a command
+            tic_patterns* ptrns = &bank->music.patterns;
+            LOAD_CHUNK(*ptrns);
+            for(s32 i = 0; i < MUSIC_PATTERNS; i++)
+                for(s32 r = 0; r < MUSIC_PATTERN_ROWS; r++)
+                {
+                    tic_track_row* row = &ptrns->data[i].rows[r];
+                    if(row->note >= NoteStart && row->command == tic_music_cmd_empty)
+                    {
+                        row->command = tic_music_cmd_volume;
+                        row->param2 = row->param1 = MAX_VOLUME - row->param1;
+                    }
+                }
+        }
+        break;
+    case CHUNK_DEFAULT:
+        memcpy(&bank->palette, Sweetie16, sizeof Sweetie16);
+        memcpy(&bank->sfx.waveforms, Waveforms, sizeof Waveforms);
+        break;
+    default: break;
+    }
+
+    #undef LOAD_CHUNK
+}
+
 void tic_cart_load(tic_cartridge* cart, const u8* buffer, s32 size)
 {
     const u8* end = buffer + size;
@@ -81,15 +106,6 @@ void tic_cart_load(tic_cartridge* cart, const u8* buffer, s32 size)
 
         switch(chunk.type)
         {
-        case CHUNK_TILES:       LOAD_CHUNK(cart->banks[chunk.bank].tiles);          break;
-        case CHUNK_SPRITES:     LOAD_CHUNK(cart->banks[chunk.bank].sprites);        break;
-        case CHUNK_MAP:         LOAD_CHUNK(cart->banks[chunk.bank].map);            break;
-        case CHUNK_SAMPLES:     LOAD_CHUNK(cart->banks[chunk.bank].sfx.samples);    break;
-        case CHUNK_WAVEFORM:    LOAD_CHUNK(cart->banks[chunk.bank].sfx.waveforms);  break;
-        case CHUNK_MUSIC:       LOAD_CHUNK(cart->banks[chunk.bank].music.tracks);   break;
-        case CHUNK_PATTERNS:    LOAD_CHUNK(cart->banks[chunk.bank].music.patterns); break;
-        case CHUNK_PALETTE:     LOAD_CHUNK(cart->banks[chunk.bank].palette);        break;
-        case CHUNK_FLAGS:       LOAD_CHUNK(cart->banks[chunk.bank].flags);          break;
         case CHUNK_CODE:        LOAD_CHUNK(code->banks[chunk.bank].data);           break;
         case CHUNK_CODE_ZIP:
             tic_tool_unzip(cart->code.data, TIC_CODE_SIZE, buffer, chunk.size);
@@ -98,29 +114,9 @@ void tic_cart_load(tic_cartridge* cart, const u8* buffer, s32 size)
             LOAD_CHUNK(cart->cover.data);
             cart->cover.size = chunk.size;
             break;
-        case CHUNK_PATTERNS_DEP: 
-            {
-                // workaround to load deprecated music patterns section
-                // and automatically convert volume value to a command
-                tic_patterns* ptrns = &cart->banks[chunk.bank].music.patterns;
-                LOAD_CHUNK(*ptrns);
-                for(s32 i = 0; i < MUSIC_PATTERNS; i++)
-                    for(s32 r = 0; r < MUSIC_PATTERN_ROWS; r++)
-                    {
-                        tic_track_row* row = &ptrns->data[i].rows[r];
-                        if(row->note >= NoteStart && row->command == tic_music_cmd_empty)
-                        {
-                            row->command = tic_music_cmd_volume;
-                            row->param2 = row->param1 = MAX_VOLUME - row->param1;
-                        }
-                    }
-            }
-            break;
-        case CHUNK_DEFAULT:
-            memcpy(&cart->banks[chunk.bank].palette, Sweetie16, sizeof Sweetie16);
-            memcpy(&cart->banks[chunk.bank].sfx.waveforms, Waveforms, sizeof Waveforms);
+        default: 
+            loadBankChunk(&cart->banks[chunk.bank], chunk.type, buffer, chunk.size);
             break;
-        default: break;
         }
 
         buffer += chunk.size;
@@ -151,107 +147,335 @@ void tic_cart_load(tic_cartridge* cart, const u8* buffer, s32 size)
     // workaround to support ancient carts without palette
     // load DB16 palette if it not exists
     if(!paletteExists)
-    {
-        static const u8 DB16[] = {0x14, 0x0c, 0x1c, 0x44, 0x24, 0x34, 0x30, 0x34, 0x6d, 0x4e, 0x4a, 0x4e, 0x85, 0x4c, 0x30, 0x34, 0x65, 0x24, 0xd0, 0x46, 0x48, 0x75, 0x71, 0x61, 0x59, 0x7d, 0xce, 0xd2, 0x7d, 0x2c, 0x85, 0x95, 0xa1, 0x6d, 0xaa, 0x2c, 0xd2, 0xaa, 0x99, 0x6d, 0xc2, 0xca, 0xda, 0xd4, 0x5e, 0xde, 0xee, 0xd6};
         memcpy(cart->bank0.palette.scn.data, DB16, sizeof DB16);
+}
+
+bool tic_cart_scan(tic_cart_index* index, const u8* buffer, s32 size)
+{
+    const u8* end = buffer + size;
+    memset(index, 0, sizeof(tic_cart_index));
+
+    while(buffer < end)
+    {
+        Chunk chunk;
+
+        if(end - buffer < sizeof(Chunk))
+            return false;
+
+        memcpy(&chunk, buffer, sizeof(Chunk));
+        buffer += sizeof(Chunk);
+
+        if(end - buffer < chunk.size)
+            return false;
+
+        // the last chunk wins, like in tic_cart_load
+        if(chunk.type < CHUNK_COUNT)
+            index->chunks[chunk.type][chunk.bank] = (tic_cart_chunk){buffer, chunk.size, true};
+
+        buffer += chunk.size;
     }
+
+    return true;
 }
 
+const tic_cart_chunk* tic_cart_get_chunk(const tic_cart_index* index, ChunkType type, s32 bank)
+{
+    const tic_cart_chunk* chunk = &index->chunks[type][bank];
+    return chunk->exists ? chunk : NULL;
+}
 
-static s32 calcBufferSize(const void* buffer, s32 size)
+void tic_cart_load_bank(tic_bank* bank, const tic_cart_index* index, s32 id)
 {
-    const u8* ptr = (u8*)buffer + size - 1;
-    const u8* end = (u8*)buffer;
+    // a saved bank has either the default chunk or its own palette and
+    // waveforms, old carts have either deprecated or new patterns
+    static const ChunkType Order[] =
+    {
+        CHUNK_DEFAULT, CHUNK_PALETTE, CHUNK_WAVEFORM, 
+        CHUNK_TILES, CHUNK_SPRITES, CHUNK_MAP, CHUNK_FLAGS,
+        CHUNK_SAMPLES, CHUNK_PATTERNS_DEP, CHUNK_PATTERNS, CHUNK_MUSIC,
+    };
 
-    while(ptr >= end)
+    memset(bank, 0, sizeof(tic_bank));
+
+    for(s32 i = 0; i < COUNT_OF(Order); i++)
     {
-        if(*ptr) break;
+        const tic_cart_chunk* chunk = tic_cart_get_chunk(index, Order[i], id);
 
-        ptr--;
-        size--;
+        if(chunk)
+            loadBankChunk(bank, Order[i], chunk->data, chunk->size);
     }
 
-    return size;
+    if(id == 0 && !tic_cart_get_chunk(index, CHUNK_PALETTE, 0) && !tic_cart_get_chunk(index, CHUNK_DEFAULT, 0))
+        memcpy(bank->palette.scn.data, DB16, sizeof DB16);
 }
 
-static u8* saveFixedChunk(u8* buffer, ChunkType type, const void* from, s32 size, s32 bank)
+void tic_cart_load_index(tic_cartridge* cart, const tic_cart_index* index)
 {
-    if(size)
+    for(s32 b = 0; b < TIC_BANKS; b++)
     {
-        Chunk chunk = {.type = type, .bank = bank, .size = size, .temp = 0};
-        memcpy(buffer, &chunk, sizeof(Chunk));
-        buffer += sizeof(Chunk);
+        bool used = b == 0;
+
+        for(s32 type = 0; type < CHUNK_COUNT && !used; type++)
+            used = index->chunks[type][b].exists;
 
-        memcpy(buffer, from, size);
-        buffer += size;
+        // untouched banks are only cleared
+        if(used)
+            tic_cart_load_bank(&cart->banks[b], index, b);
+        else
+            memset(&cart->banks[b], 0, sizeof(tic_bank));
     }
 
-    return buffer;
+    memset(&cart->code, 0, sizeof cart->code);
+    memset(&cart->cover, 0, sizeof cart->cover);
+
+    const tic_cart_chunk* zip = tic_cart_get_chunk(index, CHUNK_CODE_ZIP, 0);
+
+    if(zip)
+        tic_tool_unzip(cart->code.data, TIC_CODE_SIZE, zip->data, zip->size);
+
+    // join code banks straight from the chunks
+    if(!*cart->code.data)
+    {
+        s32 len = 0;
+
+        for(s32 b = TIC_BANKS-1; b >= 0; b--)
+        {
+            const tic_cart_chunk* chunk = tic_cart_get_chunk(index, CHUNK_CODE, b);
+
+            if(chunk)
+            {
+                // strnlen is not in C99
+                const u8* end = memchr(chunk->data, 0, chunk->size);
+                s32 size = end ? (s32)(end - chunk->data) : chunk->size;
+
+                if(size == 0)
+                    continue;
+
+                if(len && len < TIC_CODE_SIZE - 1)
+                    cart->code.data[len++] = '\n';
+
+                size = MIN(size, TIC_CODE_SIZE - 1 - len);
+                memcpy(cart->code.data + len, chunk->data, size);
+                len += size;
+            }
+        }
+    }
+
+    const tic_cart_chunk* cover = tic_cart_get_chunk(index, CHUNK_COVER, 0);
+
+    if(cover)
+    {
+        memcpy(cart->cover.data, cover->data, MIN(sizeof cart->cover.data, cover->size));
+        cart->cover.size = cover->size;
+    }
+}
+
+// trailing zeros are not saved, the aligned tail is checked word by word
+static s32 calcBufferSize(const void* buffer, s32 size)
+{
+    const u8* start = (const u8*)buffer;
+    const u8* ptr = start + size;
+
+    while(ptr > start && ((uintptr_t)ptr & (sizeof(u32) - 1)) && !ptr[-1])
+        ptr--;
+
+    if(((uintptr_t)ptr & (sizeof(u32) - 1)) == 0)
+        while(ptr - start >= (s32)sizeof(u32) && !*(const u32*)(ptr - sizeof(u32)))
+            ptr -= sizeof(u32);
+
+    while(ptr > start && !ptr[-1])
+        ptr--;
+
+    return (s32)(ptr - start);
 }
 
-static u8* saveChunk(u8* buffer, ChunkType type, const void* from, s32 size, s32 bank)
+enum
+{
+    // palette, waveforms, tiles, sprites, map, samples, patterns, music and flags
+    BankChunks = 9,
+    MaxChunks = BankChunks * TIC_BANKS + 2,
+};
+
+struct tic_cart_saver
 {
-    s32 chunkSize = calcBufferSize(from, size);
+    struct
+    {
+        Chunk header;
+        const void* data;
+    } chunks[MaxChunks];
+
+    s32 count;
+    s32 size;
+
+    z_stream zip;
+    bool zipInit;
+    u8 code[TIC_CODE_BANK_SIZE];
+};
 
-    return saveFixedChunk(buffer, type, from, chunkSize, bank);
+tic_cart_saver* tic_cart_saver_create()
+{
+    return calloc(1, sizeof(tic_cart_saver));
 }
 
-s32 tic_cart_save(const tic_cartridge* cart, u8* buffer)
+void tic_cart_saver_delete(tic_cart_saver* saver)
 {
-    u8* start = buffer;
+    if(saver)
+    {
+        if(saver->zipInit)
+            deflateEnd(&saver->zip);
 
-    #define SAVE_CHUNK(ID, FROM, BANK) saveChunk(buffer, ID, &FROM, sizeof(FROM), BANK)
+        free(saver);
+    }
+}
 
-    tic_waveforms defaultWaveforms = {0};
-    tic_palettes defaultPalettes = {0};
+static void addChunk(tic_cart_saver* saver, ChunkType type, const void* data, s32 size, s32 bank)
+{
+    if(size || type == CHUNK_DEFAULT)
+    {
+        Chunk header = {.type = type, .bank = bank, .size = size, .temp = 0};
+
+        saver->chunks[saver->count].header = header;
+        saver->chunks[saver->count].data = data;
+        saver->count++;
+
+        saver->size += sizeof(Chunk) + size;
+    }
+}
+
+// same output as tic_tool_zip, but the deflate state is reused between saves
+static s32 zipCode(tic_cart_saver* saver, const char* code, s32 size)
+{
+    z_stream* zip = &saver->zip;
+
+    if(!saver->zipInit)
+    {
+        if(deflateInit(zip, Z_BEST_COMPRESSION) != Z_OK)
+            return 0;
+
+        saver->zipInit = true;
+    }
+    else deflateReset(zip);
+
+    zip->next_in = (Bytef*)code;
+    zip->avail_in = size;
+    zip->next_out = saver->code;
+    zip->avail_out = sizeof saver->code;
+
+    return deflate(zip, Z_FINISH) == Z_STREAM_END ? (s32)zip->total_out : 0;
+}
+
+s32 tic_cart_save_size(tic_cart_saver* saver, const tic_cartridge* cart)
+{
+    saver->count = 0;
+    saver->size = 0;
 
-    memcpy(&defaultWaveforms, Waveforms, sizeof Waveforms);
-    memcpy(&defaultPalettes, Sweetie16, sizeof Sweetie16);
+    #define ADD_CHUNK(ID, FROM, BANK) addChunk(saver, ID, &FROM, calcBufferSize(&FROM, sizeof(FROM)), BANK)
 
     for(s32 i = 0; i < TIC_BANKS; i++)
     {
-        if(memcmp(&cart->banks[i].sfx.waveforms, &defaultWaveforms, sizeof defaultWaveforms) == 0
-            && memcmp(&cart->banks[i].palette, &defaultPalettes, sizeof defaultPalettes) == 0)
+        const tic_bank* bank = &cart->banks[i];
+
+        if(memcmp(&bank->sfx.waveforms, Waveforms, sizeof Waveforms) == 0
+            && calcBufferSize((const u8*)&bank->sfx.waveforms + sizeof Waveforms, sizeof(tic_waveforms) - sizeof Waveforms) == 0
+            && memcmp(&bank->palette, Sweetie16, sizeof Sweetie16) == 0
+            && calcBufferSize((const u8*)&bank->palette + sizeof Sweetie16, sizeof(tic_palettes) - sizeof Sweetie16) == 0)
         {
-            Chunk chunk = {CHUNK_DEFAULT, i, 0, 0};
-            memcpy(buffer, &chunk, sizeof chunk);
-            buffer += sizeof chunk;
+            addChunk(saver, CHUNK_DEFAULT, NULL, 0, i);
         }
         else
         {
-            buffer = SAVE_CHUNK(CHUNK_PALETTE, cart->banks[i].palette, i);
-            buffer = SAVE_CHUNK(CHUNK_WAVEFORM, cart->banks[i].sfx.waveforms, i);
+            ADD_CHUNK(CHUNK_PALETTE, bank->palette, i);
+            ADD_CHUNK(CHUNK_WAVEFORM, bank->sfx.waveforms, i);
         }
 
-        buffer = SAVE_CHUNK(CHUNK_TILES,    cart->banks[i].tiles,           i);
-        buffer = SAVE_CHUNK(CHUNK_SPRITES,  cart->banks[i].sprites,         i);
-        buffer = SAVE_CHUNK(CHUNK_MAP,      cart->banks[i].map,             i);
-        buffer = SAVE_CHUNK(CHUNK_SAMPLES,  cart->banks[i].sfx.samples,     i);
-        buffer = SAVE_CHUNK(CHUNK_PATTERNS, cart->banks[i].music.patterns,  i);
-        buffer = SAVE_CHUNK(CHUNK_MUSIC,    cart->banks[i].music.tracks,    i);
-        buffer = SAVE_CHUNK(CHUNK_FLAGS,    cart->banks[i].flags,           i);
+        ADD_CHUNK(CHUNK_TILES,    bank->tiles,           i);
+        ADD_CHUNK(CHUNK_SPRITES,  bank->sprites,         i);
+        ADD_CHUNK(CHUNK_MAP,      bank->map,             i);
+        ADD_CHUNK(CHUNK_SAMPLES,  bank->sfx.samples,     i);
+        ADD_CHUNK(CHUNK_PATTERNS, bank->music.patterns,  i);
+        ADD_CHUNK(CHUNK_MUSIC,    bank->music.tracks,    i);
+        ADD_CHUNK(CHUNK_FLAGS,    bank->flags,           i);
     }
 
+    #undef ADD_CHUNK
+
     s32 codeLen = (s32)strlen(cart->code.data);
     if(codeLen < TIC_CODE_BANK_SIZE)
-        buffer = saveFixedChunk(buffer, CHUNK_CODE, cart->code.data, codeLen, 0);
+        addChunk(saver, CHUNK_CODE, cart->code.data, codeLen, 0);
     else
     {
-        char* dst = malloc(TIC_CODE_BANK_SIZE);
-        s32 size = tic_tool_zip(dst, TIC_CODE_BANK_SIZE, cart->code.data, codeLen);
+        s32 size = zipCode(saver, cart->code.data, codeLen);
 
-        if(size)
-            buffer = saveFixedChunk(buffer, CHUNK_CODE_ZIP, dst, size, 0);
+        if(!size)
+            return saver->size = 0;
 
-        free(dst);
+        addChunk(saver, CHUNK_CODE_ZIP, saver->code, size, 0);
+    }
 
-        if(!size)
-            return 0;
+    addChunk(saver, CHUNK_COVER, cart->cover.data, cart->cover.size, 0);
+
+    return saver->size;
+}
+
+bool tic_cart_save_stream(const tic_cart_saver* saver, tic_cart_write write, void* userdata)
+{
+    if(!saver->size)
+        return false;
+
+    for(s32 i = 0; i < saver->count; i++)
+    {
+        const Chunk* header = &saver->chunks[i].header;
+
+        if(!write(header, sizeof(Chunk), userdata)
+            || (header->size && !write(saver->chunks[i].data, header->size, userdata)))
+            return false;
     }
 
-    buffer = saveFixedChunk(buffer, CHUNK_COVER, cart->cover.data, cart->cover.size, 0);
+    return true;
+}
 
-    #undef SAVE_CHUNK
+typedef struct
+{
+    u8* ptr;
+    u8* end;
+} SaveBuffer;
+
+static bool writeBuffer(const void* data, s32 size, void* userdata)
+{
+    SaveBuffer* buffer = userdata;
 
-    return (s32)(buffer - start);
+    if(buffer->end - buffer->ptr < size)
+        return false;
+
+    memcpy(buffer->ptr, data, size);
+    buffer->ptr += size;
+
+    return true;
+}
+
+s32 tic_cart_save_buffer(const tic_cart_saver* saver, u8* buffer, s32 size)
+{
+    if(size < saver->size)
+        return 0;
+
+    SaveBuffer output = {buffer, buffer + size};
+
+    return tic_cart_save_stream(saver, writeBuffer, &output) ? saver->size : 0;
+}
+
+s32 tic_cart_save(const tic_cartridge* cart, u8* buffer)
+{
+    s32 size = 0;
+    tic_cart_saver* saver = tic_cart_saver_create();
+
+    if(saver)
+    {
+        // the caller guarantees the room, same as before
+        if((size = tic_cart_save_size(saver, cart)))
+            size = tic_cart_save_buffer(saver, buffer, size);
+
+        tic_cart_saver_delete(saver);
+    }
+
+    return size;
 }
@@ -24,5 +24,63 @@
 
 #include "tic.h"
 
+typedef enum
+{
+    CHUNK_DUMMY,        // 0
+    CHUNK_TILES,        // 1
+    CHUNK_SPRITES,      // 2
+    CHUNK_COVER,        // 3
+    CHUNK_MAP,          // 4
+    CHUNK_CODE,         // 5
+    CHUNK_FLAGS,        // 6
+    CHUNK_TEMP2,        // 7
+    CHUNK_TEMP3,        // 8
+    CHUNK_SAMPLES,      // 9
+    CHUNK_WAVEFORM,     // 10
+    CHUNK_TEMP4,        // 11
+    CHUNK_PALETTE,      // 12
+    CHUNK_PATTERNS_DEP, // 13 - deprecated chunk
+    CHUNK_MUSIC,        // 14
+    CHUNK_PATTERNS,     // 15
+    CHUNK_CODE_ZIP,     // 16
+    CHUNK_DEFAULT,      // 17
+
+    CHUNK_COUNT
+} ChunkType;
+
+typedef struct
+{
+    const u8* data;
+    s32 size;
+    bool exists;
+} tic_cart_chunk;
+
+// chunk headers of a cart, the chunks point into the scanned buffer
+typedef struct
+{
+    tic_cart_chunk chunks[CHUNK_COUNT][TIC_BANKS];
+} tic_cart_index;
+
 void tic_cart_load(tic_cartridge* rom, const u8* buffer, s32 size);
 s32  tic_cart_save(const tic_cartridge* rom, u8* buffer);
+
+// scans chunk headers only, returns false if the buffer is truncated
+bool tic_cart_scan(tic_cart_index* index, const u8* buffer, s32 size);
+const tic_cart_chunk* tic_cart_get_chunk(const tic_cart_index* index, ChunkType type, s32 bank);
+void tic_cart_load_bank(tic_bank* bank, const tic_cart_index* index, s32 id);
+// same as tic_cart_load, but without the whole code scratch copy
+void tic_cart_load_index(tic_cartridge* cart, const tic_cart_index* index);
+
+// two-phase save: tic_cart_save_size lays the chunks out and returns the
+// exact output size (0 on failure), then the same layout is written to a
+// buffer or a stream; the cart must not change in between, the saver keeps
+// the code compression state and can be reused for the next save
+typedef struct tic_cart_saver tic_cart_saver;
+typedef bool(*tic_cart_write)(const void* data, s32 size, void* userdata);
+
+tic_cart_saver* tic_cart_saver_create();
+void tic_cart_saver_delete(tic_cart_saver* saver);
+s32  tic_cart_save_size(tic_cart_saver* saver, const tic_cartridge* cart);
+// returns 0 if the buffer is smaller than the computed size
+s32  tic_cart_save_buffer(const tic_cart_saver* saver, u8* buffer, s32 size);
+bool tic_cart_save_stream(const tic_cart_saver* saver, tic_cart_write write, void* userdata);
@@ -0,0 +1,247 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "api.h"
+#include "core.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// every block starts with a header, small blocks are rounded up to
+// TIC_ALLOC_ALIGN and taken from the free list of their size class,
+// refilled from the current slab; bigger ones go to the system heap
+
+#define TIC_ALLOC_ALIGN 16
+#define TIC_ALLOC_SLAB (64 * 1024)
+#define TIC_ALLOC_LARGE 0xffffffff
+
+typedef struct
+{
+    u32 size;
+    u32 cls;
+} AllocHeader;
+
+STATIC_ASSERT(alloc_header, sizeof(AllocHeader) == 8);
+
+typedef struct AllocSlab
+{
+    struct AllocSlab* next;
+    u8 align[TIC_ALLOC_ALIGN - sizeof(struct AllocSlab*)];
+} AllocSlab;
+
+static void* allocBlock(tic_core_alloc* alloc, u32 cls)
+{
+    void** head = &alloc->free[cls];
+
+    if(*head)
+    {
+        void* block = *head;
+        *head = *(void**)block;
+        return block;
+    }
+
+    u32 size = (cls + 1) * TIC_ALLOC_ALIGN;
+
+    if(alloc->ptr + size > alloc->end)
+    {
+        AllocSlab* slab = malloc(TIC_ALLOC_SLAB);
+
+        if(!slab)
+            return NULL;
+
+        slab->next = alloc->slabs;
+        alloc->slabs = slab;
+        alloc->ptr = (u8*)(slab + 1);
+        alloc->end = (u8*)slab + TIC_ALLOC_SLAB;
+    }
+
+    void* block = alloc->ptr;
+    alloc->ptr += size;
+
+    return block;
+}
+
+static bool chargeAlloc(tic_core* core, u32 size)
+{
+    tic_core_alloc* alloc = &core->alloc;
+    u32 limit = core->data ? core->data->memory : 0;
+
+    if(limit && alloc->stats.live + size > limit)
+    {
+        alloc->stats.failed++;
+        return false;
+    }
+
+    alloc->stats.live += size;
+
+    if(alloc->stats.live > alloc->stats.peak)
+        alloc->stats.peak = alloc->stats.live;
+
+    return true;
+}
+
+static inline u32 blockSize(size_t size)
+{
+    return (u32)(size + sizeof(AllocHeader) + TIC_ALLOC_ALIGN - 1) & ~(TIC_ALLOC_ALIGN - 1);
+}
+
+static inline bool isLarge(u32 total)
+{
+    return total / TIC_ALLOC_ALIGN > TIC_ALLOC_CLASSES;
+}
+
+static void* allocScript(tic_core* core, size_t size)
+{
+    u32 total = blockSize(size);
+
+    if(!chargeAlloc(core, total))
+        return NULL;
+
+    AllocHeader* header;
+    u32 cls = total / TIC_ALLOC_ALIGN - 1;
+
+    if(isLarge(total))
+    {
+        header = malloc(total);
+        cls = TIC_ALLOC_LARGE;
+    }
+    else header = allocBlock(&core->alloc, cls);
+
+    if(!header)
+    {
+        core->alloc.stats.live -= total;
+        return NULL;
+    }
+
+    header->size = total;
+    header->cls = cls;
+
+    return header + 1;
+}
+
+static void freeScript(tic_core* core, AllocHeader* header)
+{
+    core->alloc.stats.live -= header->size;
+
+    if(header->cls == TIC_ALLOC_LARGE)
+        free(header);
+    else
+    {
+        void** head = &core->alloc.free[header->cls];
+        *(void**)header = *head;
+        *head = header;
+    }
+}
+
+static void* reallocLarge(tic_core* core, AllocHeader* header, u32 total)
+{
+    u32 size = header->size;
+
+    if(total > size && !chargeAlloc(core, total - size))
+        return NULL;
+
+    AllocHeader* block = realloc(header, total);
+
+    if(!block)
+    {
+        if(total > size)
+            core->alloc.stats.live -= total - size;
+
+        return total > size ? NULL : header + 1;
+    }
+
+    if(total < size)
+        core->alloc.stats.live -= size - total;
+
+    block->size = total;
+
+    return block + 1;
+}
+
+void* tic_core_realloc(tic_mem* memory, void* ptr, size_t size)
+{
+    tic_core* core = (tic_core*)memory;
+
+    if(size > TIC_ALLOC_LARGE - TIC_ALLOC_ALIGN)
+        return NULL;
+
+    if(!ptr)
+        return size ? allocScript(core, size) : NULL;
+
+    AllocHeader* header = (AllocHeader*)ptr - 1;
+
+    if(!size)
+    {
+        freeScript(core, header);
+        return NULL;
+    }
+
+    u32 total = blockSize(size);
+
+    if(total == header->size)
+        return ptr;
+
+    if(header->cls == TIC_ALLOC_LARGE && isLarge(total))
+        return reallocLarge(core, header, total);
+
+    void* result = allocScript(core, size);
+
+    if(result)
+    {
+        memcpy(result, ptr, MIN(size, header->size - sizeof(AllocHeader)));
+        freeScript(core, header);
+    }
+    // shrinking never fails, the block is kept as is
+    else if(total < header->size)
+        return ptr;
+
+    return result;
+}
+
+void tic_core_alloc_acquire(tic_mem* memory)
+{
+    ((tic_core*)memory)->alloc.users++;
+}
+
+void tic_core_alloc_release(tic_mem* memory)
+{
+    tic_core_alloc* alloc = &((tic_core*)memory)->alloc;
+
+    // every VM holds a reference, the pool goes with the last one
+    if(--alloc->users > 0)
+        return;
+
+    for(AllocSlab* slab = alloc->slabs; slab;)
+    {
+        AllocSlab* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    memset(alloc, 0, sizeof(tic_core_alloc));
+}
+
+const tic80_script_memory* tic_core_script_memory(tic_mem* memory)
+{
+    return &((tic_core*)memory)->alloc.stats;
+}
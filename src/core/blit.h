@@ -0,0 +1,162 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// the 4bpp VRAM to 32bpp screen converter used by the blit, kept in a header
+// so build/tools/blitbench.c can compare the SIMD path with the scalar one
+
+#include "tic.h"
+
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   define TIC_BLIT_NEON
+#   include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define TIC_BLIT_SSE2
+#   include <emmintrin.h>
+#endif
+
+// 4bpp to 32bpp row converter, every byte holds two pixels, low nibble first
+typedef struct
+{
+    u32 pal[TIC_PALETTE_SIZE];
+
+#if defined(TIC_BLIT_NEON)
+    // byte planes of the palette for table lookups
+    uint8x16x4_t planes;
+#elif defined(TIC_BLIT_SSE2)
+    // both pixels of every possible byte, built once the palette
+    // holds for two rows in a row, SCN gradients go the scalar way
+    u64 pairs[1 << BITS_IN_BYTE];
+    bool ready;
+#endif
+} BlitLut;
+
+static inline void initBlitLut(BlitLut* lut, const u32* pal)
+{
+    memcpy(lut->pal, pal, sizeof lut->pal);
+
+#if defined(TIC_BLIT_NEON)
+    lut->planes = vld4q_u8((const u8*)lut->pal);
+#elif defined(TIC_BLIT_SSE2)
+    for(s32 i = 0; i < COUNT_OF(lut->pairs); i++)
+        lut->pairs[i] = pal[i & 0xf] | (u64)pal[i >> 4] << 32;
+
+    lut->ready = true;
+#endif
+}
+
+static inline void updateBlitLut(BlitLut* lut, const u32* pal)
+{
+    if(memcmp(lut->pal, pal, sizeof lut->pal))
+    {
+#if defined(TIC_BLIT_SSE2)
+        memcpy(lut->pal, pal, sizeof lut->pal);
+        lut->ready = false;
+#else
+        initBlitLut(lut, pal);
+#endif
+    }
+#if defined(TIC_BLIT_SSE2)
+    else if(!lut->ready)
+        initBlitLut(lut, pal);
+#endif
+}
+
+#if defined(TIC_BLIT_NEON)
+
+static inline uint8x16_t blitLookup(uint8x16_t table, uint8x16_t index)
+{
+#if defined(__aarch64__)
+    return vqtbl1q_u8(table, index);
+#else
+    uint8x8x2_t pair = {{vget_low_u8(table), vget_high_u8(table)}};
+    return vcombine_u8(vtbl2_u8(pair, vget_low_u8(index)), vtbl2_u8(pair, vget_high_u8(index)));
+#endif
+}
+
+#endif
+
+static inline void blitNibblesScalar(const BlitLut* lut, u32* dst, const u8* src, s32 size)
+{
+    for(const u8* end = src + size; src != end; src++)
+    {
+        *dst++ = lut->pal[*src & 0xf];
+        *dst++ = lut->pal[*src >> 4];
+    }
+}
+
+static inline void blitNibbles(const BlitLut* lut, u32* dst, const u8* src, s32 size)
+{
+    const u8* end = src + size;
+
+#if defined(TIC_BLIT_NEON)
+
+    const uint8x8_t mask = vdup_n_u8(0xf);
+
+    for(; end - src >= 8; src += 8, dst += 16)
+    {
+        uint8x8_t val = vld1_u8(src);
+        uint8x8x2_t index = vzip_u8(vand_u8(val, mask), vshr_n_u8(val, 4));
+        uint8x16_t pixels = vcombine_u8(index.val[0], index.val[1]);
+
+        uint8x16x4_t out;
+        out.val[0] = blitLookup(lut->planes.val[0], pixels);
+        out.val[1] = blitLookup(lut->planes.val[1], pixels);
+        out.val[2] = blitLookup(lut->planes.val[2], pixels);
+        out.val[3] = blitLookup(lut->planes.val[3], pixels);
+
+        vst4q_u8((u8*)dst, out);
+    }
+
+#elif defined(TIC_BLIT_SSE2)
+
+    if(lut->ready)
+        for(; end - src >= 2; src += 2, dst += 4)
+        {
+            __m128i lo = _mm_loadl_epi64((const __m128i*)&lut->pairs[src[0]]);
+            __m128i hi = _mm_loadl_epi64((const __m128i*)&lut->pairs[src[1]]);
+
+            _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi64(lo, hi));
+        }
+
+#endif
+
+    blitNibblesScalar(lut, dst, src, (s32)(end - src));
+}
+
+// horizontal offset rotates the row, pixel 0 lands at `pos`
+static inline void blitRow(const BlitLut* lut, u32* dst, const u8* src, s32 pos)
+{
+    if(pos == 0)
+        blitNibbles(lut, dst, src, TIC80_WIDTH / 2);
+    else
+    {
+        u32 row[TIC80_WIDTH];
+        blitNibbles(lut, row, src, TIC80_WIDTH / 2);
+
+        memcpy(dst + pos, row, (TIC80_WIDTH - pos) * sizeof *row);
+        memcpy(dst, row + TIC80_WIDTH - pos, pos * sizeof *row);
+    }
+}
@@ -22,6 +22,7 @@
 
 #include "api.h"
 #include "core.h"
+#include "blit.h"
 #include "tilesheet.h"
 
 #include <assert.h>
@@ -54,6 +55,7 @@ static void setPixelOvr(tic_mem* tic, s32 x, s32 y, u8 color)
     tic_core* core = (tic_core*)tic;
 
     *getOvrAddr(tic, x, y) = *(core->state.ovr.raw + color);
+    core->blit.drawn[y] = true;
 }
 
 static u8 getPixelOvr(tic_mem* tic, s32 x, s32 y)
@@ -77,6 +79,7 @@ static void drawHLineOvr(tic_mem* tic, s32 x1, s32 x2, s32 y, u8 color)
     for (s32 x = x1; x < x2; ++x) {
         *getOvrAddr(tic, x, y) = final_color;
     }
+    core->blit.drawn[y] = true;
 }
 
 u8 tic_api_peek(tic_mem* memory, s32 address)
@@ -87,10 +90,32 @@ u8 tic_api_peek(tic_mem* memory, s32 address)
     return 0;
 }
 
+void tic_core_vram_dirty(tic_mem* memory, s32 address, s32 size)
+{
+    enum
+    {
+        Start = offsetof(tic_ram, vram.screen),
+        End = Start + sizeof(tic_screen),
+        RowSize = TIC80_WIDTH * TIC_PALETTE_BPP / BITS_IN_BYTE,
+    };
+
+    if (address < End && address + size > Start)
+    {
+        tic_core* core = (tic_core*)memory;
+        s32 first = (MAX(address, Start) - Start) / RowSize;
+        s32 last = (MIN(address + size, End) - Start - 1) / RowSize;
+
+        memset(core->blit.dirty + first, true, last - first + 1);
+    }
+}
+
 void tic_api_poke(tic_mem* memory, s32 address, u8 value)
 {
     if (address >= 0 && address < sizeof(tic_ram))
+    {
         *((u8*)&memory->ram + address) = value;
+        tic_core_vram_dirty(memory, address, 1);
+    }
 }
 
 u8 tic_api_peek4(tic_mem* memory, s32 address)
@@ -104,7 +129,10 @@ u8 tic_api_peek4(tic_mem* memory, s32 address)
 void tic_api_poke4(tic_mem* memory, s32 address, u8 value)
 {
     if (address >= 0 && address < sizeof(tic_ram) * 2)
+    {
         tic_tool_poke4((u8*)&memory->ram, address, value);
+        tic_core_vram_dirty(memory, address >> 1, 1);
+    }
 }
 
 void tic_api_memcpy(tic_mem* memory, s32 dst, s32 src, s32 size)
@@ -120,6 +148,7 @@ void tic_api_memcpy(tic_mem* memory, s32 dst, s32 src, s32 size)
     {
         u8* base = (u8*)&memory->ram;
         memcpy(base + dst, base + src, size);
+        tic_core_vram_dirty(memory, dst, size);
     }
 }
 
@@ -134,6 +163,7 @@ void tic_api_memset(tic_mem* memory, s32 dst, u8 val, s32 size)
     {
         u8* base = (u8*)&memory->ram;
         memset(base + dst, val, size);
+        tic_core_vram_dirty(memory, dst, size);
     }
 }
 
@@ -219,7 +249,10 @@ s32 tic_api_tstamp(tic_mem* memory)
 
 static void setPixelDma(tic_mem* tic, s32 x, s32 y, u8 color)
 {
+    tic_core* core = (tic_core*)tic;
+
     tic_tool_poke4(tic->ram.vram.screen.data, y * TIC80_WIDTH + x, color);
+    core->blit.dirty[y] = true;
 }
 
 static u8 getPixelDma(tic_mem* tic, s32 x, s32 y)
@@ -233,6 +266,7 @@ static void drawHLineDma(tic_mem* memory, s32 xl, s32 xr, s32 y, u8 color)
 {
     color = color << 4 | color;
     if (xl >= xr) return;
+    ((tic_core*)memory)->blit.dirty[y] = true;
     if (xl & 1) {
         tic_tool_poke4(&memory->ram.vram.screen.data, y * TIC80_WIDTH + xl, color);
         xl++;
@@ -405,6 +439,7 @@ static void resetDma(tic_mem* memory)
     core->state.setpix = setPixelDma;
     core->state.getpix = getPixelDma;
     core->state.drawhline = drawHLineDma;
+    core->state.dma = true;
 }
 
 void tic_api_reset(tic_mem* memory)
@@ -422,6 +457,7 @@ void tic_api_reset(tic_mem* memory)
     core->state.initialized = false;
     core->state.scanline = NULL;
     core->state.ovr.callback = NULL;
+    core->blit.valid = false;
 
     resetDma(memory);
 
@@ -455,6 +491,50 @@ static void initCover(tic_mem* tic)
     }
 }
 
+static inline bool isProfiling(tic_core* core)
+{
+    return core->profile.enabled && core->state.initialized && core->data;
+}
+
+static inline u64 profileStart(tic_core* core)
+{
+    return isProfiling(core) ? core->data->counter(core->data->data) : 0;
+}
+
+static inline void profileEnd(tic_core* core, tic_profile_phase phase, u64 start)
+{
+    if (isProfiling(core))
+        core->profile.frames[core->profile.frame].time[phase] += core->data->counter(core->data->data) - start;
+}
+
+static void profileNextFrame(tic_core* core)
+{
+    tic_profile* profile = &core->profile;
+
+    if (isProfiling(core))
+    {
+        profile->freq = core->data->freq(core->data->data);
+        profile->frame = (profile->frame + 1) % TIC_PROFILE_FRAMES;
+        profile->count = MIN(profile->count + 1, TIC_PROFILE_FRAMES - 1);
+
+        ZEROMEM(profile->frames[profile->frame]);
+    }
+}
+
+void tic_core_profile(tic_mem* memory, bool enable)
+{
+    tic_core* core = (tic_core*)memory;
+
+    ZEROMEM(core->profile);
+    core->profile.enabled = enable;
+}
+
+const tic_profile* tic_core_profile_data(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    return &core->profile;
+}
+
 static void cart2ram(tic_mem* memory)
 {
     static const u8 Font[] =
@@ -468,6 +548,36 @@ static void cart2ram(tic_mem* memory)
     initCover(memory);
 }
 
+// only one VM is alive at a time, so the memory limit and the stats
+// of a cart don't include the VM of the previous one
+static void closeScripts(tic_mem* memory)
+{
+#if defined(TIC_BUILD_WITH_SQUIRREL)
+    getSquirrelScriptConfig()->close(memory);
+#endif
+
+#if defined(TIC_BUILD_WITH_LUA)
+    getLuaScriptConfig()->close(memory);
+
+#   if defined(TIC_BUILD_WITH_MOON)
+    getMoonScriptConfig()->close(memory);
+#   endif
+
+#   if defined(TIC_BUILD_WITH_FENNEL)
+    getFennelConfig()->close(memory);
+#   endif
+
+#endif /* defined(TIC_BUILD_WITH_LUA) */
+
+#if defined(TIC_BUILD_WITH_JS)
+    getJsScriptConfig()->close(memory);
+#endif
+
+#if defined(TIC_BUILD_WITH_WREN)
+    getWrenScriptConfig()->close(memory);
+#endif
+}
+
 void tic_core_tick(tic_mem* tic, tic_tick_data* data)
 {
     tic_core* core = (tic_core*)tic;
@@ -497,8 +607,11 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
                 tic->input.keyboard = 1;
             else tic->input.data = -1;  // default is all enabled
 
+            core->gc.frame = compareMetatag(code, "gc", "frame", config->singleComment);
+
             data->start = data->counter(core->data->data);
 
+            closeScripts(tic);
             done = config->init(tic, code);
         }
         else
@@ -508,9 +621,14 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
 
         if (done)
         {
+            // the init code has its own budget
+            core->budget.used = core->budget.poll = 0;
+            core->budget.abort = NULL;
+
             core->state.tick = config->tick;
             core->state.scanline = config->scanline;
             core->state.ovr.callback = config->overline;
+            core->gc.collect = core->gc.frame ? config->collect : NULL;
 
             core->state.initialized = true;
         }
@@ -528,7 +646,9 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
             ZEROMEM(tic->ram.input.mouse);
     }
 
+    u64 start = profileStart(core);
     core->state.tick(tic);
+    profileEnd(core, tic_profile_tick, start);
 }
 
 void tic_core_pause(tic_mem* memory)
@@ -556,6 +676,7 @@ void tic_core_resume(tic_mem* memory)
         memcpy(&core->state, &core->pause.state, sizeof(tic_core_state_data));
         memcpy(&memory->ram, &core->pause.ram, sizeof(tic_ram));
         memory->input.data = core->pause.input;
+        core->blit.valid = false;
         core->data->start = core->pause.time.start + core->data->counter(core->data->data) - core->pause.time.paused;
     }
 }
@@ -566,45 +687,74 @@ void tic_core_close(tic_mem* memory)
 
     core->state.initialized = false;
 
-#if defined(TIC_BUILD_WITH_SQUIRREL)
-    getSquirrelScriptConfig()->close(memory);
-#endif
+    closeScripts(memory);
 
-#if defined(TIC_BUILD_WITH_LUA)
-    getLuaScriptConfig()->close(memory);
+    tic_core_sound_stream(memory, 0);
 
-#   if defined(TIC_BUILD_WITH_MOON)
-    getMoonScriptConfig()->close(memory);
-#   endif
+    for(s32 i = 0; i < TIC_CHUNK_CACHE_SIZE; i++)
+        free(core->chunks.items[i].data);
 
-#   if defined(TIC_BUILD_WITH_FENNEL)
-    getFennelConfig()->close(memory);
-#   endif
+    blip_delete(core->blip.left);
+    blip_delete(core->blip.right);
 
-#endif /* defined(TIC_BUILD_WITH_LUA) */
+    free(memory->samples.buffer);
+    free(core);
+}
 
+const char* tic_core_budget_charge(tic_mem* memory, u32 count)
+{
+    tic_core* core = (tic_core*)memory;
+    tic_tick_data* data = core->data;
 
-#if defined(TIC_BUILD_WITH_JS)
-    getJsScriptConfig()->close(memory);
-#endif
+    if(!data)
+        return NULL;
 
-#if defined(TIC_BUILD_WITH_WREN)
-    getWrenScriptConfig()->close(memory);
-#endif
+    if(core->budget.abort)
+        return core->budget.abort;
 
-    blip_delete(core->blip.left);
-    blip_delete(core->blip.right);
+    core->budget.used += count;
+    core->budget.poll += count;
 
-    free(memory->samples.buffer);
-    free(core);
+    // polling the host is expensive, only runaway frames get here
+    if(core->budget.poll >= TIC_POLL_INSTRUCTIONS)
+    {
+        core->budget.poll = 0;
+
+        if(data->forceExit && data->forceExit(data->data))
+            return core->budget.abort = "script execution was interrupted";
+    }
+
+    if(data->budget && core->budget.used > data->budget)
+        return core->budget.abort = "script exceeded the instruction budget per frame";
+
+    return NULL;
+}
+
+const char* tic_core_budget_aborted(tic_mem* memory)
+{
+    return ((tic_core*)memory)->budget.abort;
 }
 
 void tic_core_tick_start(tic_mem* memory)
 {
-    tic_core_sound_tick_start(memory);
+    tic_core* core = (tic_core*)memory;
+
+    profileNextFrame(core);
+
+    core->budget.used = core->budget.poll = 0;
+    core->budget.abort = NULL;
+
+    if (core->gc.collect && core->data)
+        core->gc.start = core->data->counter(core->data->data);
+
+    {
+        u64 start = profileStart(core);
+        tic_core_sound_tick_start(memory);
+        profileEnd(core, tic_profile_music, start);
+    }
+
     tic_core_tick_io(memory);
 
-    tic_core* core = (tic_core*)memory;
     core->state.synced = 0;
     resetDma(memory);
 }
@@ -617,11 +767,16 @@ void tic_core_tick_end(tic_mem* memory)
     core->state.gamepads.previous.data = input->gamepads.data;
     core->state.keyboard.previous.data = input->keyboard.data;
 
-    tic_core_sound_tick_end(memory);
+    {
+        u64 start = profileStart(core);
+        tic_core_sound_tick_end(memory);
+        profileEnd(core, tic_profile_sound, start);
+    }
 
     core->state.setpix = setPixelOvr;
     core->state.getpix = getPixelOvr;
     core->state.drawhline = drawHLineOvr;
+    core->state.dma = false;
 }
 
 // copied from SDL2
@@ -654,12 +809,62 @@ static inline void memset4(void* dst, u32 val, u32 dwords)
 #endif
 }
 
+static bool isRowChanged(tic_core* core, s32 row, s32 src, bool dirty, const u8* vram, const u32* pal, s32 offset)
+{
+    const tic_screen_row* cache = &core->blit.rows[row];
+
+    return !core->blit.valid
+        || core->blit.drawn[row]
+        || cache->offset != offset
+        || memcmp(cache->pal, pal, sizeof cache->pal)
+        || ((dirty || cache->src != src) && memcmp(cache->vram, vram, sizeof cache->vram));
+}
+
+void tic_core_blit_invalidate(tic_mem* tic, s32 y, s32 height)
+{
+    tic_core* core = (tic_core*)tic;
+
+    s32 first = MAX(y, 0);
+    s32 last = MIN(y + height, TIC80_HEIGHT);
+
+    if (first < last)
+        memset(core->blit.drawn + first, true, last - first);
+}
+
+// a quarter of the frame is left to the host, counters without
+// sub-millisecond resolution get a single step per frame
+static void collectGarbage(tic_core* core)
+{
+    u64 freq = core->data->freq(core->data->data);
+    u64 deadline = 0;
+
+    if (freq >= 1000)
+    {
+        u64 frame = freq / TIC80_FRAMERATE;
+        deadline = core->gc.start + frame - frame / 4;
+    }
+
+    core->gc.count++;
+    core->gc.collect((tic_mem*)core, deadline);
+}
+
 void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data)
 {
+    tic_core* core = (tic_core*)tic;
+    u64 blitStart = profileStart(core);
+    u64 callbacks = 0;
+
+// SCN/OVR time is accounted separately and excluded from BLIT
+#define PROFILE_CALLBACK(PHASE, CALL) do    \
+{                                           \
+    u64 start = profileStart(core);         \
+    CALL;                                   \
+    callbacks += profileStart(core) - start;\
+    profileEnd(core, PHASE, start);         \
+} while(0)
+
     // init OVR palette
     {
-        tic_core* core = (tic_core*)tic;
-
         const tic_palette* ovr = &core->state.ovr.palette;
         bool ovrEmpty = true;
         for (s32 i = 0; i < sizeof(tic_palette); i++)
@@ -670,10 +875,13 @@ void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline s
     }
 
     if (scanline)
-        scanline(tic, 0, data);
+        PROFILE_CALLBACK(tic_profile_scanline, scanline(tic, 0, data));
 
     const u32* pal = tic_tool_palette_blit(&tic->ram.vram.palette, fmt);
 
+    BlitLut lut;
+    initBlitLut(&lut, pal);
+
     enum { Top = (TIC80_FULLHEIGHT - TIC80_HEIGHT) / 2, Bottom = Top };
     enum { Left = (TIC80_FULLWIDTH - TIC80_WIDTH) / 2, Right = Left };
 
@@ -681,36 +889,68 @@ void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline s
 
     memset4(&out[0 * TIC80_FULLWIDTH], pal[tic->ram.vram.vars.border], TIC80_FULLWIDTH * Top);
 
+    // VRAM rows written during this blit by SCN stay dirty for the next one
+    bool dirty[TIC80_HEIGHT];
+    memcpy(dirty, core->blit.dirty, sizeof dirty);
+    ZEROMEM(core->blit.dirty);
+
+    s32 converted = 0;
+
     u32* rowPtr = out + (Top * TIC80_FULLWIDTH);
     for (s32 r = 0; r < TIC80_HEIGHT; r++, rowPtr += TIC80_FULLWIDTH)
     {
         u32* colPtr = rowPtr + Left;
         memset4(rowPtr, pal[tic->ram.vram.vars.border], Left);
 
-        s32 pos = (r + tic->ram.vram.vars.offset.y + TIC80_HEIGHT) % TIC80_HEIGHT * TIC80_WIDTH >> 1;
+        s32 src = (r + tic->ram.vram.vars.offset.y + TIC80_HEIGHT) % TIC80_HEIGHT;
+        s32 offset = (-tic->ram.vram.vars.offset.x + TIC80_WIDTH) % TIC80_WIDTH;
+        const u8* vram = tic->ram.vram.screen.data + src * TIC80_WIDTH / 2;
 
-        u32 x = (-tic->ram.vram.vars.offset.x + TIC80_WIDTH) % TIC80_WIDTH;
-        for (s32 c = 0; c < TIC80_WIDTH / 2; c++)
+        if (isRowChanged(core, r, src, dirty[src] || core->blit.dirty[src], vram, lut.pal, offset))
         {
-            u8 val = ((u8*)tic->ram.vram.screen.data)[pos + c];
-            *(colPtr + (x++ % TIC80_WIDTH)) = pal[val & 0xf];
-            *(colPtr + (x++ % TIC80_WIDTH)) = pal[val >> 4];
+            blitRow(&lut, colPtr, vram, offset);
+
+            memcpy(core->blit.rows[r].vram, vram, sizeof core->blit.rows[r].vram);
+            memcpy(core->blit.rows[r].pal, lut.pal, sizeof lut.pal);
+            core->blit.rows[r].offset = offset;
+            core->blit.drawn[r] = false;
+            converted++;
         }
 
+        // same content could come from another VRAM row
+        core->blit.rows[r].src = src;
+
         memset4(rowPtr + (TIC80_FULLWIDTH - Right), pal[tic->ram.vram.vars.border], Right);
 
         if (scanline && (r < TIC80_HEIGHT - 1))
         {
-            scanline(tic, r + 1, data);
+            PROFILE_CALLBACK(tic_profile_scanline, scanline(tic, r + 1, data));
             pal = tic_tool_palette_blit(&tic->ram.vram.palette, fmt);
+            updateBlitLut(&lut, pal);
         }
     }
 
     memset4(&out[(TIC80_FULLHEIGHT - Bottom) * TIC80_FULLWIDTH], pal[tic->ram.vram.vars.border], TIC80_FULLWIDTH * Bottom);
 
     if (overline)
-        overline(tic, data);
+        PROFILE_CALLBACK(tic_profile_overline, overline(tic, data));
+
+#undef PROFILE_CALLBACK
+
+    // untracked writes happen while no cart is running
+    core->blit.valid = core->state.initialized;
 
+    profileEnd(core, tic_profile_blit, blitStart + callbacks);
+
+    if (isProfiling(core))
+        core->profile.frames[core->profile.frame].rows = converted;
+
+    if (core->state.initialized && core->gc.collect)
+    {
+        u64 start = profileStart(core);
+        collectGarbage(core);
+        profileEnd(core, tic_profile_gc, start);
+    }
 }
 
 static inline void scanline(tic_mem* memory, s32 row, void* data)
@@ -29,6 +29,20 @@
 #define CLOCKRATE (255<<13)
 #define TIC_DEFAULT_COLOR tic_color_white
 
+// scripts are charged with VM instructions in steps, coarse ones without
+// a budget, and the host is asked for a forced exit once per
+// TIC_POLL_INSTRUCTIONS in a frame
+#define TIC_BUDGET_STEP 1000
+#define TIC_POLL_STEP 100000
+#define TIC_POLL_INSTRUCTIONS 10000000
+
+// script VM blocks up to TIC_ALLOC_CLASSES * 16 bytes are pooled by size
+#define TIC_ALLOC_CLASSES 32
+
+// compiled script chunks kept in memory, keyed by md5 of the language and the code
+#define TIC_CHUNK_CACHE_SIZE 8
+#define TIC_CHUNK_HASH_SIZE 16
+
 typedef struct
 {
     s32 time;       /* clock time of next delta */
@@ -156,11 +170,44 @@ typedef struct
     u8 (*getpix)(tic_mem* memory, s32 x, s32 y);
     void (*drawhline)(tic_mem* memory, s32 xl, s32 xr, s32 y, u8 color);
 
+    // the functions above draw to VRAM, not to the OVR screen
+    bool dma;
+
     u32 synced;
 
     bool initialized;
 } tic_core_state_data;
 
+typedef struct
+{
+    u8 vram[TIC80_WIDTH * TIC_PALETTE_BPP / BITS_IN_BYTE];
+    u32 pal[TIC_PALETTE_SIZE];
+    s32 offset;
+    s32 src;
+} tic_screen_row;
+
+// script VM heap, pooled blocks are carved from slabs
+// which are released when the VM is closed
+typedef struct
+{
+    void* slabs;
+    u8* ptr;
+    u8* end;
+    void* free[TIC_ALLOC_CLASSES];
+    tic80_script_memory stats;
+
+    // VMs allocating from the pool
+    s32 users;
+} tic_core_alloc;
+
+typedef struct
+{
+    u8 hash[TIC_CHUNK_HASH_SIZE];
+    u8* data;
+    s32 size;
+    u32 used;
+} tic_core_chunk;
+
 typedef struct
 {
     tic_mem memory; // it should be first
@@ -185,6 +232,44 @@ typedef struct
 
     };
 
+    // script callbacks resolved after init and after every TIC() call:
+    // registry refs for Lua, presence flags for JS and Squirrel
+    struct
+    {
+        s32 tic;
+        s32 scn;
+        s32 scanline;
+        s32 ovr;
+    } callback;
+
+    // VM instructions run since the frame start and since the last host poll,
+    // abort is sticky till the frame end, so the error raised by the VM
+    // is raised again if the script catches it
+    struct
+    {
+        u64 used;
+        u64 poll;
+        const char* abort;
+    } budget;
+
+    tic_core_alloc alloc;
+
+    // compiled chunks survive restarts and reset(), freed with the core
+    struct
+    {
+        tic_core_chunk items[TIC_CHUNK_CACHE_SIZE];
+        u32 time;
+    } chunks;
+
+    // '-- gc: frame' runs the collector in the time left after the blit
+    struct
+    {
+        bool frame;
+        u64 start;
+        u32 count;
+        void(*collect)(tic_mem* memory, u64 deadline);
+    } gc;
+
     struct
     {
         blip_buffer_t* left;
@@ -193,10 +278,31 @@ typedef struct
     
     s32 samplerate;
 
+    // set when the sound is synthesized on the audio thread
+    tic_sound_stream* stream;
+
     tic_tick_data* data;
 
     tic_core_state_data state;
 
+    tic_profile profile;
+
+    // blit reconverts only the screen rows whose VRAM or inputs changed
+    struct
+    {
+        bool valid;
+
+        // VRAM rows written since the last blit
+        bool dirty[TIC80_HEIGHT];
+
+        // screen rows drawn over after the blit
+        bool drawn[TIC80_HEIGHT];
+
+        // what every screen row was converted from
+        tic_screen_row rows[TIC80_HEIGHT];
+
+    } blit;
+
     struct
     {
         tic_core_state_data state;   
@@ -238,5 +344,22 @@ const tic_script_config* getWrenScriptConfig();
 #endif
 
 void tic_core_tick_io(tic_mem* memory);
+void tic_core_vram_dirty(tic_mem* memory, s32 address, s32 size);
+float* tic_core_mesh_ram(tic_mem* memory, s32 address, s32 stride, const s32* indices, s32 icount, s32* vcount);
+void tic_core_map_batch(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapBatchFunc remap, void* data);
 void tic_core_sound_tick_start(tic_mem* memory);
 void tic_core_sound_tick_end(tic_mem* memory);
+
+// charges the running script with count VM instructions,
+// returns the reason to interrupt it or NULL
+const char* tic_core_budget_charge(tic_mem* memory, u32 count);
+// the reason the frame was aborted or NULL, set even if the script caught the error
+const char* tic_core_budget_aborted(tic_mem* memory);
+
+// allocator for the script VMs with realloc semantics, size 0 frees
+// the block, fails when tic_tick_data.memory would be exceeded;
+// every VM acquires the pool before its creation and releases it
+// after its destruction, the slabs are freed with the last user
+void* tic_core_realloc(tic_mem* memory, void* ptr, size_t size);
+void tic_core_alloc_acquire(tic_mem* memory);
+void tic_core_alloc_release(tic_mem* memory);
@@ -120,18 +120,140 @@ static void drawRectBorder(tic_core* core, s32 x, s32 y, s32 width, s32 height,
         s32 xx = x; \
         for(s32 px=sx; px < ex; px++, xx++) \
         { \
-            u8 color = mapping[tic_tilesheet_gettilepix(tile, (X), (Y))];\
+            u8 color = mapping[pixels[(X) + (Y) * TIC_SPRITESIZE]];\
             if(color != TRANSPARENT_COLOR) core->state.setpix(&core->memory, xx, y, color); \
         } \
     } \
     } while(0)
 
+#define GET_TILE_PIXELS_DEF(BPP) \
+static void getTilePixels##BPP(const tic_tileptr* tile, u8* pixels) \
+{ \
+    for (s32 y = 0; y < TIC_SPRITESIZE; y++) \
+        for (s32 x = 0; x < TIC_SPRITESIZE; x++) \
+            *pixels++ = tic_tilesheet_gettilepix##BPP(tile, x, y); \
+}
+
+TIC_BPP_LIST(GET_TILE_PIXELS_DEF)
+
+#undef GET_TILE_PIXELS_DEF
+
+// unpacks tile color indices row by row, the bpp is dispatched once per tile
+static void getTilePixels(const tic_tileptr* tile, u8* pixels)
+{
+    switch (tile->segment->bpp)
+    {
+    case tic_bpp_4: getTilePixels4(tile, pixels); break;
+    case tic_bpp_2: getTilePixels2(tile, pixels); break;
+    case tic_bpp_1: getTilePixels1(tile, pixels); break;
+    }
+}
+
 #define REVERT(X) (TIC_SPRITESIZE - 1 - (X))
 
-static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
+// 4bpp tile row or column as 8 packed nibbles, pixel 0 in the lowest one
+static inline u32 getTileRow4(const u8* ptr, s32 y)
 {
-    u8* mapping = getPalette(&core->memory, colors, count);
+    ptr += y * TIC_SPRITESIZE / 2;
+    return ptr[0] | ptr[1] << 8 | ptr[2] << 16 | (u32)ptr[3] << 24;
+}
+
+static inline u32 getTileCol4(const u8* ptr, s32 x)
+{
+    u32 col = 0;
+    ptr += x >> 1;
+
+    for (s32 i = 0, shift = (x & 1) << 2; i < TIC_SPRITESIZE; i++, ptr += TIC_SPRITESIZE / 2)
+        col |= (u32)((*ptr >> shift) & 0xf) << (i << 2);
+
+    return col;
+}
+
+// writes up to 8 packed nibbles to VRAM starting at x, only where mask is set
+static inline void drawSpan4(tic_core* core, s32 x, s32 y, u64 colors, u64 mask)
+{
+    u8* dst = core->memory.ram.vram.screen.data + ((y * TIC80_WIDTH + x) >> 1);
+    s32 shift = (x & 1) << 2;
+
+    colors <<= shift;
+    mask <<= shift;
+
+    for (; mask; mask >>= BITS_IN_BYTE, colors >>= BITS_IN_BYTE, dst++)
+    {
+        u8 m = (u8)mask;
+        if (m) *dst = (*dst & ~m) | ((u8)colors & m);
+    }
+
+    core->blit.dirty[y] = true;
+}
+
+static inline u32 reverseNibbles(u32 val)
+{
+    val = (val >> 4 & 0x0f0f0f0f) | (val & 0x0f0f0f0f) << 4;
+    val = (val >> 8 & 0x00ff00ff) | (val & 0x00ff00ff) << 8;
+    return val >> 16 | val << 16;
+}
+
+// 0xf for every non zero nibble
+static inline u32 nonZeroNibbles(u32 val)
+{
+    return ((val | val >> 1 | val >> 2 | val >> 3) & 0x11111111) * 0xf;
+}
+
+// scale 1 4bpp tiles drawn to VRAM, a row is decoded once and written as nibble pairs
+static void drawTile4(tic_core* core, const u8* ptr, s32 x, s32 y, s32 sx, s32 sy, s32 ex, s32 ey, const u8* mapping, u32 orientation)
+{
+    // without palette remapping colors are copied as is and transparency becomes a nibble mask
+    bool direct = true;
+    u32 keys[TIC_PALETTE_SIZE];
+    s32 keysCount = 0;
+
+    for (s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+    {
+        if (mapping[i] == TRANSPARENT_COLOR)
+            keys[keysCount++] = i * 0x11111111;
+        else if (mapping[i] != i)
+            direct = false;
+    }
+
+    const u32 clip = (u32)(((u64)1 << (ex << 2)) - 1) & ~(((u32)1 << (sx << 2)) - 1);
+
+    for (s32 py = sy; py < ey; py++, y++)
+    {
+        s32 line = orientation & 0b010 ? REVERT(py) : py;
+        u32 src = orientation & 0b100 ? getTileCol4(ptr, line) : getTileRow4(ptr, line);
+
+        if (orientation & 0b001)
+            src = reverseNibbles(src);
+
+        u32 colors = src, mask = clip;
+
+        if (direct)
+        {
+            for (s32 i = 0; i < keysCount; i++)
+                mask &= nonZeroNibbles(src ^ keys[i]);
+        }
+        else
+        {
+            colors = 0;
+
+            for (s32 px = sx; px < ex; px++)
+            {
+                u8 color = mapping[src >> (px << 2) & 0xf];
+
+                if (color == TRANSPARENT_COLOR)
+                    mask &= ~((u32)0xf << (px << 2));
+                else colors |= (u32)color << (px << 2);
+            }
+        }
+
+        if (mask)
+            drawSpan4(core, x, y, (colors & mask) >> (sx << 2), mask >> (sx << 2));
+    }
+}
 
+static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* mapping, s32 scale, tic_flip flip, tic_rotate rotate)
+{
     rotate &= 0b11;
     u32 orientation = flip & 0b11;
 
@@ -149,6 +271,19 @@ static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors
         ey = core->state.clip.b - y; if (ey > TIC_SPRITESIZE) ey = TIC_SPRITESIZE;
         y += sy;
         x += sx;
+
+        if (sx >= ex || sy >= ey)
+            return;
+
+        if (core->state.dma && tile->segment->bpp == tic_bpp_4)
+        {
+            drawTile4(core, tile->ptr, x, y, sx, sy, ex, ey, mapping, orientation);
+            return;
+        }
+
+        u8 pixels[TIC_SPRITESIZE * TIC_SPRITESIZE];
+        getTilePixels(tile, pixels);
+
         switch (orientation) {
         case 0b100: DRAW_TILE_BODY(py, px); break;
         case 0b110: DRAW_TILE_BODY(REVERT(py), px); break;
@@ -164,6 +299,9 @@ static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors
 
     if (EARLY_CLIP(x, y, TIC_SPRITESIZE * scale, TIC_SPRITESIZE * scale)) return;
 
+    u8 pixels[TIC_SPRITESIZE * TIC_SPRITESIZE];
+    getTilePixels(tile, pixels);
+
     for (s32 py = 0; py < TIC_SPRITESIZE; py++, y += scale)
     {
         s32 xx = x;
@@ -174,7 +312,7 @@ static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors
             if (orientation & 0b100) {
                 s32 tmp = ix; ix = iy; iy = tmp;
             }
-            u8 color = mapping[tic_tilesheet_gettilepix(tile, ix, iy)];
+            u8 color = mapping[pixels[ix + iy * TIC_SPRITESIZE]];
             if (color != TRANSPARENT_COLOR) drawRect(core, xx, y, scale, scale, color);
         }
     }
@@ -186,9 +324,10 @@ static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors
 static void drawSprite(tic_core* core, s32 index, s32 x, s32 y, s32 w, s32 h, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
 {
     tic_tilesheet sheet = getTileSheetFromSegment(&core->memory, core->memory.ram.vram.blit.segment);
+    u8* mapping = getPalette(&core->memory, colors, count);
     if (w == 1 && h == 1) {
         tic_tileptr tile = tic_tilesheet_gettile(&sheet, index, false);
-        drawTile(core, &tile, x, y, colors, count, scale, flip, rotate);
+        drawTile(core, &tile, x, y, mapping, scale, flip, rotate);
     }
     else
     {
@@ -230,19 +369,88 @@ static void drawSprite(tic_core* core, s32 index, s32 x, s32 y, s32 w, s32 h, u8
 
                 tic_tileptr tile = tic_tilesheet_gettile(&sheet, index + mx + my * cols, false);
                 if (rotate == 0 || rotate == 2)
-                    drawTile(core, &tile, x + i * step, y + j * step, colors, count, scale, flip, rotate);
+                    drawTile(core, &tile, x + i * step, y + j * step, mapping, scale, flip, rotate);
                 else
-                    drawTile(core, &tile, x + j * step, y + i * step, colors, count, scale, flip, rotate);
+                    drawTile(core, &tile, x + j * step, y + i * step, mapping, scale, flip, rotate);
             }
         }
     }
 }
 
+static inline s32 wrapCoord(s32 val, s32 size)
+{
+    val %= size;
+    return val < 0 ? val + size : val;
+}
+
+// range of map cells drawn at (sx, sy) with the given cell size that intersect the clip rect
+static bool getVisibleCells(const tic_core* core, s32 sx, s32 sy, s32 width, s32 height, s32 size, tic_rect* cells)
+{
+    const tic_clip_data* clip = &core->state.clip;
+
+    s32 i0 = clip->l > sx ? (clip->l - sx) / size : 0;
+    s32 j0 = clip->t > sy ? (clip->t - sy) / size : 0;
+    s32 i1 = clip->r > sx ? MIN(width, (clip->r - sx + size - 1) / size) : 0;
+    s32 j1 = clip->b > sy ? MIN(height, (clip->b - sy + size - 1) / size) : 0;
+
+    *cells = (tic_rect){i0, j0, i1 - i0, j1 - j0};
+
+    return cells->w > 0 && cells->h > 0;
+}
+
+// the most common map() call: no remap and scale 1, only the cells inside the clip rect are
+// visited, wrapping is done incrementally and tile pointers are resolved once per index
+static void drawMapFast(tic_core* core, const tic_map* src, const tic_tilesheet* sheet, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* mapping)
+{
+    enum { Size = TIC_SPRITESIZE };
+
+    tic_rect cells;
+    if (!getVisibleCells(core, sx, sy, width, height, Size, &cells))
+        return;
+
+    const s32 i0 = cells.x, j0 = cells.y, i1 = cells.x + cells.w, j1 = cells.y + cells.h;
+
+    tic_tileptr tiles[TIC_BANK_SPRITES];
+    bool cached[TIC_BANK_SPRITES] = {false};
+
+    s32 mj = wrapCoord(y + j0, TIC_MAP_HEIGHT);
+
+    for (s32 j = j0, jj = sy + j0 * Size; j < j1; j++, jj += Size)
+    {
+        const u8* row = src->data + mj * TIC_MAP_WIDTH;
+        s32 mi = wrapCoord(x + i0, TIC_MAP_WIDTH);
+
+        for (s32 i = i0, ii = sx + i0 * Size; i < i1; i++, ii += Size)
+        {
+            u8 index = row[mi];
+
+            if (!cached[index])
+            {
+                tiles[index] = tic_tilesheet_gettile(sheet, index, true);
+                cached[index] = true;
+            }
+
+            drawTile(core, &tiles[index], ii, jj, mapping, 1, tic_no_flip, tic_no_rotate);
+
+            if (++mi == TIC_MAP_WIDTH) mi = 0;
+        }
+
+        if (++mj == TIC_MAP_HEIGHT) mj = 0;
+    }
+}
+
 static void drawMap(tic_core* core, const tic_map* src, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapFunc remap, void* data)
 {
     const s32 size = TIC_SPRITESIZE * scale;
 
     tic_tilesheet sheet = getTileSheetFromSegment(&core->memory, core->memory.ram.vram.blit.segment);
+    u8* mapping = getPalette(&core->memory, colors, count);
+
+    if (!remap && scale == 1)
+    {
+        drawMapFast(core, src, &sheet, x, y, width, height, sx, sy, mapping);
+        return;
+    }
 
     for (s32 j = y, jj = sy; j < y + height; j++, jj += size)
         for (s32 i = x, ii = sx; i < x + width; i++, ii += size)
@@ -262,7 +470,7 @@ static void drawMap(tic_core* core, const tic_map* src, s32 x, s32 y, s32 width,
                 remap(data, mi, mj, &retile);
 
             tic_tileptr tile = tic_tilesheet_gettile(&sheet, retile.index, true);
-            drawTile(core, &tile, ii, jj, colors, count, scale, retile.flip, retile.rotate);
+            drawTile(core, &tile, ii, jj, mapping, scale, retile.flip, retile.rotate);
         }
 }
 
@@ -272,15 +480,18 @@ static s32 drawChar(tic_core* core, tic_tileptr* font_char, s32 x, s32 y, s32 sc
 
     s32 j = 0, start = 0, end = Size;
 
+    u8 pixels[Size * Size];
+    getTilePixels(font_char, pixels);
+
     if (!fixed) {
         for (s32 i = 0; i < Size; i++) {
             for (j = 0; j < Size; j++)
-                if (mapping[tic_tilesheet_gettilepix(font_char, i, j)] != TRANSPARENT_COLOR) break;
+                if (mapping[pixels[i + j * Size]] != TRANSPARENT_COLOR) break;
             if (j < Size) break; else start++;
         }
         for (s32 i = Size - 1; i >= start; i--) {
             for (j = 0; j < Size; j++)
-                if (mapping[tic_tilesheet_gettilepix(font_char, i, j)] != TRANSPARENT_COLOR) break;
+                if (mapping[pixels[i + j * Size]] != TRANSPARENT_COLOR) break;
             if (j < Size) break; else end--;
         }
     }
@@ -294,7 +505,7 @@ static s32 drawChar(tic_core* core, tic_tileptr* font_char, s32 x, s32 y, s32 sc
     {
         for (s32 j = 0, row = rowStart, ys = y; j < Size; j++, row += rowStep, ys += scale)
         {
-            u8 color = tic_tilesheet_gettilepix(font_char, col, row);
+            u8 color = pixels[col + row * Size];
             if (mapping[color] != TRANSPARENT_COLOR)
                 drawRect(core, xs, ys, scale, scale, mapping[color]);
         }
@@ -360,6 +571,7 @@ void tic_api_cls(tic_mem* memory, u8 color)
     {
         color &= 0b00001111;
         memset(memory->ram.vram.screen.data, color | (color << TIC_PALETTE_BPP), sizeof(memory->ram.vram.screen.data));
+        tic_core_vram_dirty(memory, offsetof(tic_ram, vram.screen), sizeof(memory->ram.vram.screen.data));
     }
     else
     {
@@ -630,7 +842,87 @@ static void ticTexLine(tic_mem* memory, TexVert* v0, TexVert* v1)
     }
 }
 
-static void drawTexturedTriangle(tic_core* core, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count)
+typedef struct
+{
+    s32 index;
+    tic_tileptr tile;
+} TexTileCache;
+
+// neighbouring pixels mostly sample the same map tile, so the tile pointer is only
+// resolved when the tile index changes
+#define TEXTRI_PIXEL_DEF(BPP) \
+static inline u8 getTexMapPixel##BPP(const u8* map, const tic_tilesheet* sheet, TexTileCache* cache, s32 u, s32 v) \
+{ \
+    enum { MapWidth = TIC_MAP_WIDTH * TIC_SPRITESIZE, MapHeight = TIC_MAP_HEIGHT * TIC_SPRITESIZE }; \
+    s32 iu = (u >> 16) % MapWidth; \
+    s32 iv = (v >> 16) % MapHeight; \
+ \
+    if (iu < 0) iu += MapWidth; \
+    if (iv < 0) iv += MapHeight; \
+ \
+    u8 index = map[(iv >> 3) * TIC_MAP_WIDTH + (iu >> 3)]; \
+ \
+    if (index != cache->index) \
+    { \
+        cache->index = index; \
+        cache->tile = tic_tilesheet_gettile(sheet, index, true); \
+    } \
+ \
+    return tic_tilesheet_gettilepix##BPP(&cache->tile, iu & 7, iv & 7); \
+} \
+ \
+static inline u8 getTexSheetPixel##BPP(const tic_tilesheet* sheet, s32 u, s32 v) \
+{ \
+    enum { SheetWidth = TIC_SPRITESHEET_SIZE, SheetHeight = TIC_SPRITESHEET_SIZE * TIC_SPRITE_BANKS }; \
+    return tic_tilesheet_getpix##BPP(sheet, (u >> 16) & (SheetWidth - 1), (v >> 16) & (SheetHeight - 1)); \
+}
+
+TIC_BPP_LIST(TEXTRI_PIXEL_DEF)
+
+#undef TEXTRI_PIXEL_DEF
+
+#define TEXTRI_MAP_PIXEL(BPP, U, V) getTexMapPixel##BPP(map, &sheet, &cache, U, V)
+#define TEXTRI_SHEET_PIXEL(BPP, U, V) getTexSheetPixel##BPP(&sheet, U, V)
+
+// u/z, v/z and 1/z are linear in screen space, so the perspective span divides per pixel
+#define TEXTRI_SPAN(PIXEL, BPP) do { \
+    if (depth) \
+    { \
+        for (s32 x = left; x < right; x++, uq += duqdx, vq += dvqdx, q += dqdx) \
+        { \
+            float w = 65536.0f / q; \
+            span[x] = mapping[PIXEL(BPP, (s32)(uq * w), (s32)(vq * w))]; \
+        } \
+    } \
+    else \
+    { \
+        for (s32 x = left; x < right; x++, u += dudxs, v += dvdxs) \
+            span[x] = mapping[PIXEL(BPP, u, v)]; \
+    } \
+    } while(0)
+
+// the span is already clipped, transparent pixels are skipped
+static void drawTexSpan(tic_core* core, s32 y, s32 left, s32 right, const u8* span)
+{
+    if (core->state.dma)
+    {
+        u8* screen = core->memory.ram.vram.screen.data;
+
+        for (s32 x = left, i = y * TIC80_WIDTH + left; x < right; x++, i++)
+            if (span[x] != TRANSPARENT_COLOR)
+                tic_tool_poke4(screen, i, span[x]);
+
+        core->blit.dirty[y] = true;
+    }
+    else
+    {
+        for (s32 x = left; x < right; x++)
+            if (span[x] != TRANSPARENT_COLOR)
+                core->state.setpix(&core->memory, x, y, span[x]);
+    }
+}
+
+static void drawTexturedTriangle(tic_core* core, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count, float z1, float z2, float z3, bool depth)
 {
     tic_mem* memory = &core->memory;
     u8* mapping = getPalette(memory, colors, count);
@@ -638,6 +930,8 @@ static void drawTexturedTriangle(tic_core* core, float x1, float y1, float x2, f
 
     const u8* map = memory->ram.map.data;
     tic_tilesheet sheet = getTileSheetFromSegment(memory, memory->ram.vram.blit.segment);
+    const tic_bpp bpp = sheet.segment->bpp;
+    TexTileCache cache = {-1};
 
     V0.x = x1;  V0.y = y1;  V0.u = u1;  V0.v = v1;
     V1.x = x2;  V1.y = y2;  V1.u = u2;  V1.v = v2;
@@ -658,82 +952,177 @@ static void drawTexturedTriangle(tic_core* core, float x1, float y1, float x2, f
     //  convert to fixed
     s32 dudxs = (s32)(dudx * 65536.0f);
     s32 dvdxs = (s32)(dvdx * 65536.0f);
-    //  fill the buffer 
-    initSidesBuffer();
+
+    //  perspective correction needs every vertex in front of the camera
+    depth = depth && z1 > 0 && z2 > 0 && z3 > 0;
+
+    float q0 = 0, duqdx = 0, duqdy = 0, dvqdx = 0, dvqdy = 0, dqdx = 0, dqdy = 0;
+    float uq0 = 0, vq0 = 0;
+
+    if (depth)
+    {
+        //  plane gradients of u/z, v/z and 1/z relative to the third vertex
+        const float q[] = {1.0f / z1, 1.0f / z2, 1.0f / z3};
+        const float uq[] = {u1 * q[0], u2 * q[1], u3 * q[2]};
+        const float vq[] = {v1 * q[0], v2 * q[1], v3 * q[2]};
+
+#define PLANE_DX(A) (((A)[0] - (A)[2]) * (V1.y - V2.y) - ((A)[1] - (A)[2]) * (V0.y - V2.y)) * id
+#define PLANE_DY(A) (((A)[1] - (A)[2]) * (V0.x - V2.x) - ((A)[0] - (A)[2]) * (V1.x - V2.x)) * id
+
+        dqdx = PLANE_DX(q);     dqdy = PLANE_DY(q);
+        duqdx = PLANE_DX(uq);   duqdy = PLANE_DY(uq);
+        dvqdx = PLANE_DX(vq);   dvqdy = PLANE_DY(vq);
+
+#undef PLANE_DX
+#undef PLANE_DY
+
+        q0 = q[2]; uq0 = uq[2]; vq0 = vq[2];
+    }
+
+    //  only the rows the edges can reach are reset and scanned
+    s32 yt = MAX(0, (s32)MIN(V0.y, MIN(V1.y, V2.y)));
+    s32 yb = MIN(TIC80_HEIGHT, (s32)MAX(V0.y, MAX(V1.y, V2.y)) + 1);
+
+    if (yt >= yb)
+        return;
+
+    for (s32 y = yt; y < yb; y++)
+        SidesBuffer.Left[y] = TIC80_WIDTH, SidesBuffer.Right[y] = -1;
+
     //  parse each line and decide where in the buffer to store them ( left or right ) 
     ticTexLine(memory, &V0, &V1);
     ticTexLine(memory, &V1, &V2);
     ticTexLine(memory, &V2, &V0);
 
-    for (s32 y = 0; y < TIC80_HEIGHT; y++)
+    yt = MAX(yt, core->state.clip.t);
+    yb = MIN(yb, core->state.clip.b);
+
+    u8 span[TIC80_WIDTH];
+
+    for (s32 y = yt; y < yb; y++)
     {
         //  if it's backwards skip it
-        s32 width = SidesBuffer.Right[y] - SidesBuffer.Left[y];
-        //  if it's off top or bottom , skip this line
-        if ((y < core->state.clip.t) || (y > core->state.clip.b))
-            width = 0;
-        if (width > 0)
+        if (SidesBuffer.Right[y] <= SidesBuffer.Left[y])
+            continue;
+
+        s32 u = SidesBuffer.ULeft[y];
+        s32 v = SidesBuffer.VLeft[y];
+        s32 left = SidesBuffer.Left[y];
+        s32 right = MIN(SidesBuffer.Right[y], core->state.clip.r);
+
+        //  check left edge and offset UV's if we are off the left 
+        if (left < core->state.clip.l)
         {
-            s32 u = SidesBuffer.ULeft[y];
-            s32 v = SidesBuffer.VLeft[y];
-            s32 left = SidesBuffer.Left[y];
-            s32 right = SidesBuffer.Right[y];
-            //  check right edge, and CLAMP it
-            if (right > core->state.clip.r)
-                right = core->state.clip.r;
-            //  check left edge and offset UV's if we are off the left 
-            if (left < core->state.clip.l)
-            {
-                s32 dist = core->state.clip.l - SidesBuffer.Left[y];
-                u += dudxs * dist;
-                v += dvdxs * dist;
-                left = core->state.clip.l;
-            }
-            //  are we drawing from the map . ok then at least check before the inner loop
-            if (use_map == true)
-            {
-                for (s32 x = left; x < right; ++x)
-                {
-                    enum { MapWidth = TIC_MAP_WIDTH * TIC_SPRITESIZE, MapHeight = TIC_MAP_HEIGHT * TIC_SPRITESIZE };
-                    s32 iu = (u >> 16) % MapWidth;
-                    s32 iv = (v >> 16) % MapHeight;
+            s32 dist = core->state.clip.l - left;
+            u += dudxs * dist;
+            v += dvdxs * dist;
+            left = core->state.clip.l;
+        }
 
-                    while (iu < 0) iu += MapWidth;
-                    while (iv < 0) iv += MapHeight;
+        if (left >= right)
+            continue;
 
-                    u8 tileindex = map[(iv >> 3) * TIC_MAP_WIDTH + (iu >> 3)];
-                    tic_tileptr tile = tic_tilesheet_gettile(&sheet, tileindex, true);
+        //  perspective attributes are sampled at pixel centers
+        float dx = left + 0.5f - V2.x, dy = y + 0.5f - V2.y;
+        float q = q0 + dqdx * dx + dqdy * dy;
+        float uq = uq0 + duqdx * dx + duqdy * dy;
+        float vq = vq0 + dvqdx * dx + dvqdy * dy;
 
-                    u8 color = mapping[tic_tilesheet_gettilepix(&tile, iu & 7, iv & 7)];
-                    if (color != TRANSPARENT_COLOR)
-                        setPixel(core, x, y, color);
-                    u += dudxs;
-                    v += dvdxs;
-                }
+        //  are we drawing from the map . ok then at least check before the inner loop
+        if (use_map == true)
+        {
+            switch (bpp)
+            {
+            case tic_bpp_4: TEXTRI_SPAN(TEXTRI_MAP_PIXEL, 4); break;
+            case tic_bpp_2: TEXTRI_SPAN(TEXTRI_MAP_PIXEL, 2); break;
+            case tic_bpp_1: TEXTRI_SPAN(TEXTRI_MAP_PIXEL, 1); break;
             }
-            else
+        }
+        else
+        {
+            //  direct from tile ram 
+            switch (bpp)
             {
-                //  direct from tile ram 
-                for (s32 x = left; x < right; ++x)
-                {
-                    enum { SheetWidth = TIC_SPRITESHEET_SIZE, SheetHeight = TIC_SPRITESHEET_SIZE * TIC_SPRITE_BANKS };
-                    s32 iu = (u >> 16) & (SheetWidth - 1);
-                    s32 iv = (v >> 16) & (SheetHeight - 1);
-
-                    u8 color = mapping[tic_tilesheet_getpix(&sheet, iu, iv)];
-                    if (color != TRANSPARENT_COLOR)
-                        setPixel(core, x, y, color);
-                    u += dudxs;
-                    v += dvdxs;
-                }
+            case tic_bpp_4: TEXTRI_SPAN(TEXTRI_SHEET_PIXEL, 4); break;
+            case tic_bpp_2: TEXTRI_SPAN(TEXTRI_SHEET_PIXEL, 2); break;
+            case tic_bpp_1: TEXTRI_SPAN(TEXTRI_SHEET_PIXEL, 1); break;
             }
         }
+
+        drawTexSpan(core, y, left, right, span);
     }
 }
 
-void tic_api_textri(tic_mem* memory, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count)
+#undef TEXTRI_SPAN
+#undef TEXTRI_MAP_PIXEL
+#undef TEXTRI_SHEET_PIXEL
+
+void tic_api_textri(tic_mem* memory, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count, float z1, float z2, float z3, bool depth)
+{
+    drawTexturedTriangle((tic_core*)memory, x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, use_map, colors, count, z1, z2, z3, depth);
+}
+
+// vertices are packed x, y, u, v for textured triangles and x, y when color is set,
+// indices (or consecutive vertices without them) form a triangle list, with cull
+// triangles wound counter-clockwise on screen are skipped
+void tic_api_mesh(tic_mem* memory, const float* vertices, s32 vcount, const s32* indices, s32 icount, s32 color, bool use_map, u8* colors, s32 count, bool cull)
 {
-    drawTexturedTriangle((tic_core*)memory, x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, use_map, colors, count);
+    tic_core* core = (tic_core*)memory;
+    const s32 stride = color < 0 ? 4 : 2;
+    const s32 triangles = (indices ? icount : vcount) / 3;
+
+    for (s32 i = 0; i < triangles; i++)
+    {
+        const float* v[3];
+        s32 j = 0;
+
+        for (; j < COUNT_OF(v); j++)
+        {
+            s32 index = indices ? indices[i * 3 + j] : i * 3 + j;
+
+            if (index < 0 || index >= vcount)
+                break;
+
+            v[j] = vertices + index * stride;
+        }
+
+        if (j < COUNT_OF(v))
+            continue;
+
+        if (cull && (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[2][0] - v[0][0]) * (v[1][1] - v[0][1]) < 0)
+            continue;
+
+        if (color < 0)
+            drawTexturedTriangle(core, v[0][0], v[0][1], v[1][0], v[1][1], v[2][0], v[2][1], 
+                v[0][2], v[0][3], v[1][2], v[1][3], v[2][2], v[2][3], use_map, colors, count, 0, 0, 0, false);
+        else
+            tic_api_tri(memory, (s32)v[0][0], (s32)v[0][1], (s32)v[1][0], (s32)v[1][1], (s32)v[2][0], (s32)v[2][1], color);
+    }
+}
+
+// mesh() vertices stored in RAM as little-endian s16 components, as many as the
+// indices refer to are read into a new buffer the caller frees
+float* tic_core_mesh_ram(tic_mem* memory, s32 address, s32 stride, const s32* indices, s32 icount, s32* vcount)
+{
+    s32 size = 0;
+
+    for (s32 i = 0; i < icount; i++)
+        size = MAX(size, indices[i] + 1);
+
+    size = MIN(size, TIC_RAM_SIZE / (stride * (s32)sizeof(s16)));
+
+    // at least one vertex, so NULL always means out of memory
+    float* values = malloc(MAX(size, 1) * stride * sizeof(float));
+
+    if (values)
+        for (s32 i = 0, addr = address; i < size * stride; i++, addr += sizeof(s16))
+            values[i] = addr >= 0 && addr + 1 < TIC_RAM_SIZE
+                ? (s16)(memory->ram.data[addr] | memory->ram.data[addr + 1] << 8)
+                : 0;
+
+    *vcount = values ? size : 0;
+
+    return values;
 }
 
 void tic_api_map(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapFunc remap, void* data)
@@ -741,6 +1130,46 @@ void tic_api_map(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, s32 sx, s
     drawMap((tic_core*)memory, &memory->ram.map, x, y, width, height, sx, sy, colors, count, scale, remap, data);
 }
 
+void tic_core_map_batch(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapBatchFunc remap, void* data)
+{
+    tic_core* core = (tic_core*)memory;
+    const tic_map* src = &memory->ram.map;
+    const s32 size = TIC_SPRITESIZE * scale;
+
+    tic_rect rect;
+    if (scale < 1 || !getVisibleCells(core, sx, sy, width, height, size, &rect))
+        return;
+
+    RemapResult cells[TIC_MAP_BATCH_SIZE];
+
+    for (s32 j = 0, mj = wrapCoord(y + rect.y, TIC_MAP_HEIGHT); j < rect.h; j++)
+    {
+        const u8* row = src->data + mj * TIC_MAP_WIDTH;
+        RemapResult* cell = cells + j * rect.w;
+
+        for (s32 i = 0, mi = wrapCoord(x + rect.x, TIC_MAP_WIDTH); i < rect.w; i++, cell++)
+        {
+            *cell = (RemapResult){row[mi], tic_no_flip, tic_no_rotate};
+            if (++mi == TIC_MAP_WIDTH) mi = 0;
+        }
+
+        if (++mj == TIC_MAP_HEIGHT) mj = 0;
+    }
+
+    remap(data, x + rect.x, y + rect.y, rect.w, rect.h, cells);
+
+    tic_tilesheet sheet = getTileSheetFromSegment(memory, memory->ram.vram.blit.segment);
+    u8* mapping = getPalette(memory, colors, count);
+
+    const RemapResult* cell = cells;
+    for (s32 j = 0, jj = sy + rect.y * size; j < rect.h; j++, jj += size)
+        for (s32 i = 0, ii = sx + rect.x * size; i < rect.w; i++, ii += size, cell++)
+        {
+            tic_tileptr tile = tic_tilesheet_gettile(&sheet, cell->index, true);
+            drawTile(core, &tile, ii, jj, mapping, scale, cell->flip, cell->rotate);
+        }
+}
+
 void tic_api_mset(tic_mem* memory, s32 x, s32 y, u8 value)
 {
     if (x < 0 || x >= TIC_MAP_WIDTH || y < 0 || y >= TIC_MAP_HEIGHT) return;
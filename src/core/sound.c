@@ -23,7 +23,9 @@
 
 #include "api.h"
 #include "core.h"
+#include "thread.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #define ENVELOPE_FREQ_SCALE 2
@@ -39,6 +41,7 @@ STATIC_ASSERT(tic_track_pattern, sizeof(tic_track_pattern) == 3 * MUSIC_PATTERN_
 STATIC_ASSERT(tic_track, sizeof(tic_track) == 3 * MUSIC_FRAMES + 3);
 STATIC_ASSERT(tic_music_cmd_count, tic_music_cmd_count == 1 << MUSIC_CMD_BITS);
 STATIC_ASSERT(tic_sound_state_size, sizeof(tic_sound_state) == 4);
+STATIC_ASSERT(wave_values_pow2, (WAVE_VALUES & (WAVE_VALUES - 1)) == 0);
 
 static inline s32 getTempo(const tic_track* track) { return track->tempo + DEFAULT_TEMPO; }
 static inline s32 getSpeed(const tic_track* track) { return track->speed + DEFAULT_SPEED; }
@@ -59,11 +62,15 @@ static inline s32 param2val(const tic_track_row* row)
     return (row->param1 << 4) | row->param2;
 }
 
-static void update_amp(blip_buffer_t* blip, tic_sound_register_data* data, s32 new_amp)
+static inline void update_amp(blip_buffer_t* blip, tic_sound_register_data* data, s32 time, s32 new_amp)
 {
     s32 delta = new_amp - data->amp;
-    data->amp += delta;
-    blip_add_delta(blip, data->time, delta);
+
+    if (delta)
+    {
+        data->amp = new_amp;
+        blip_add_delta(blip, time, delta);
+    }
 }
 
 static inline s32 freq2period(s32 freq)
@@ -86,31 +93,66 @@ static inline s32 getAmp(const tic_sound_register* reg, s32 amp)
     return (amp * AmpMax / MAX_VOLUME) * reg->volume / MAX_VOLUME / TIC_SOUND_CHANNELS;
 }
 
-static void runEnvelope(blip_buffer_t* blip, const tic_sound_register* reg, tic_sound_register_data* data, s32 end_time, u8 volume)
+// left and right channels step through the same phases, only the amplitudes
+// differ, so both are run in one pass with per frame amplitude tables
+
+static void runEnvelope(blip_buffer_t* blipLeft, blip_buffer_t* blipRight, const tic_sound_register* reg, 
+    tic_sound_register_data* left, tic_sound_register_data* right, s32 end_time, u8 volumeLeft, u8 volumeRight)
 {
+    s32 time = left->time;
+
+    if (time >= end_time)
+        return;
+
+    s32 ampLeft[WAVE_VALUES], ampRight[WAVE_VALUES];
+
+    for (s32 i = 0; i < WAVE_VALUES; i++)
+    {
+        s32 value = tic_tool_peek4(reg->waveform.data, i);
+        ampLeft[i] = getAmp(reg, value * volumeLeft / MAX_VOLUME);
+        ampRight[i] = getAmp(reg, value * volumeRight / MAX_VOLUME);
+    }
+
     s32 period = freq2period(reg->freq * ENVELOPE_FREQ_SCALE);
+    s32 phase = left->phase;
 
-    for (; data->time < end_time; data->time += period)
+    for (; time < end_time; time += period)
     {
-        data->phase = (data->phase + 1) % WAVE_VALUES;
+        phase = (phase + 1) & (WAVE_VALUES - 1);
 
-        update_amp(blip, data, getAmp(reg, tic_tool_peek4(reg->waveform.data, data->phase) * volume / MAX_VOLUME));
+        update_amp(blipLeft, left, time, ampLeft[phase]);
+        update_amp(blipRight, right, time, ampRight[phase]);
     }
+
+    left->time = right->time = time;
+    left->phase = right->phase = phase;
 }
 
-static void runNoise(blip_buffer_t* blip, const tic_sound_register* reg, tic_sound_register_data* data, s32 end_time, u8 volume)
+static void runNoise(blip_buffer_t* blipLeft, blip_buffer_t* blipRight, const tic_sound_register* reg, 
+    tic_sound_register_data* left, tic_sound_register_data* right, s32 end_time, u8 volumeLeft, u8 volumeRight)
 {
-    // phase is noise LFSR, which must never be zero 
-    if (data->phase == 0)
-        data->phase = 1;
+    s32 time = left->time;
 
-    s32 period = freq2period(reg->freq);
+    // phase is noise LFSR, which must never be zero 
+    s32 phase = left->phase ? left->phase : 1;
 
-    for (; data->time < end_time; data->time += period)
+    if (time < end_time)
     {
-        data->phase = ((data->phase & 1) * (0b11 << 13)) ^ (data->phase >> 1);
-        update_amp(blip, data, getAmp(reg, (data->phase & 1) ? volume : 0));
+        const s32 ampLeft = getAmp(reg, volumeLeft);
+        const s32 ampRight = getAmp(reg, volumeRight);
+        const s32 period = freq2period(reg->freq);
+
+        for (; time < end_time; time += period)
+        {
+            phase = ((phase & 1) * (0b11 << 13)) ^ (phase >> 1);
+
+            update_amp(blipLeft, left, time, (phase & 1) ? ampLeft : 0);
+            update_amp(blipRight, right, time, (phase & 1) ? ampRight : 0);
+        }
     }
+
+    left->time = right->time = time;
+    left->phase = right->phase = phase;
 }
 
 static s32 calcLoopPos(const tic_sound_loop* loop, s32 pos)
@@ -480,24 +522,27 @@ void tic_api_sfx(tic_mem* memory, s32 index, s32 note, s32 octave, s32 duration,
     setSfxChannelData(memory, index, note, octave, duration, channel, left, right, speed);
 }
 
-static void stereo_tick_end(tic_mem* memory, tic_sound_register_data* registers, blip_buffer_t* blip, u8 stereoRight)
+static void stereo_tick_end(const tic_sound_register* regs, const tic_stereo_volume* stereo, 
+    tic_sound_register_data* left, tic_sound_register_data* right, blip_buffer_t* blipLeft, blip_buffer_t* blipRight)
 {
     enum { EndTime = CLOCKRATE / TIC80_FRAMERATE };
     for (s32 i = 0; i < TIC_SOUND_CHANNELS; ++i)
     {
-        u8 volume = tic_tool_peek4(&memory->ram.stereo.data, stereoRight + i * 2);
+        u8 volumeLeft = tic_tool_peek4(&stereo->data, i * 2);
+        u8 volumeRight = tic_tool_peek4(&stereo->data, i * 2 + 1);
 
-        const tic_sound_register* reg = &memory->ram.registers[i];
-        tic_sound_register_data* data = registers + i;
+        const tic_sound_register* reg = &regs[i];
 
         tic_tool_is_noise(&reg->waveform)
-            ? runNoise(blip, reg, data, EndTime, volume)
-            : runEnvelope(blip, reg, data, EndTime, volume);
+            ? runNoise(blipLeft, blipRight, reg, left + i, right + i, EndTime, volumeLeft, volumeRight)
+            : runEnvelope(blipLeft, blipRight, reg, left + i, right + i, EndTime, volumeLeft, volumeRight);
 
-        data->time -= EndTime;
+        left[i].time -= EndTime;
+        right[i].time -= EndTime;
     }
 
-    blip_end_frame(blip, EndTime);
+    blip_end_frame(blipLeft, EndTime);
+    blip_end_frame(blipRight, EndTime);
 }
 
 void tic_core_sound_tick_start(tic_mem* memory)
@@ -520,13 +565,296 @@ void tic_core_sound_tick_start(tic_mem* memory)
     }
 }
 
+// frames the last registers are repeated for before the output goes silent
+#define SOUND_HOLD_FRAMES 8
+
+typedef struct
+{
+    tic_sound_register registers[TIC_SOUND_CHANNELS];
+    tic_stereo_volume stereo;
+} SoundFrame;
+
+// single producer (tick) / single consumer (audio thread) ring of register
+// snapshots, the consumer owns its own synthesizer state
+struct tic_sound_stream
+{
+    SoundFrame* queue;
+    s32 size;   // power of two
+    s32 depth;  // frames queued ahead before new ones are dropped
+    volatile s32 head;
+    volatile s32 tail;
+
+    // last frame, repeated while the queue is empty
+    SoundFrame frame;
+    s32 starved;
+
+    struct
+    {
+        blip_buffer_t* left;
+        blip_buffer_t* right;
+    } blip;
+
+    struct
+    {
+        tic_sound_register_data left[TIC_SOUND_CHANNELS];
+        tic_sound_register_data right[TIC_SOUND_CHANNELS];
+    } registers;
+
+    s16* samples;
+    s32 capacity;
+    s32 count;
+    s32 pos;
+};
+
+// returns the number of stereo samples read, at most max
+static s32 synthesize(const tic_sound_register* regs, const tic_stereo_volume* stereo, 
+    tic_sound_register_data* left, tic_sound_register_data* right, 
+    blip_buffer_t* blipLeft, blip_buffer_t* blipRight, s16* samples, s32 max)
+{
+    stereo_tick_end(regs, stereo, left, right, blipLeft, blipRight);
+
+    s32 count = MIN(blip_samples_avail(blipLeft), max);
+
+    blip_read_samples(blipLeft, samples, count, TIC_STEREO_CHANNELS);
+    blip_read_samples(blipRight, samples + 1, count, TIC_STEREO_CHANNELS);
+
+    return count;
+}
+
 void tic_core_sound_tick_end(tic_mem* memory)
 {
     tic_core* core = (tic_core*)memory;
+    tic_sound_stream* stream = core->stream;
+
+    if (stream)
+    {
+        s32 head = stream->head;
+
+        // drop the frame if the audio thread falls behind
+        if (head - tic_atomic_load(&stream->tail) < stream->depth)
+        {
+            SoundFrame* frame = &stream->queue[head & (stream->size - 1)];
+
+            memcpy(frame->registers, memory->ram.registers, sizeof frame->registers);
+            frame->stereo = memory->ram.stereo;
+
+            tic_atomic_store(&stream->head, head + 1);
+        }
+
+        memset(memory->samples.buffer, 0, memory->samples.size);
+        return;
+    }
+
+    synthesize(memory->ram.registers, &memory->ram.stereo, 
+        core->state.registers.left, core->state.registers.right, 
+        core->blip.left, core->blip.right, 
+        memory->samples.buffer, core->samplerate / TIC80_FRAMERATE);
+}
+
+static void freeStream(tic_sound_stream* stream)
+{
+    blip_delete(stream->blip.left);
+    blip_delete(stream->blip.right);
+    free(stream->samples);
+    free(stream->queue);
+    free(stream);
+}
+
+bool tic_core_sound_stream(tic_mem* memory, s32 frames)
+{
+    tic_core* core = (tic_core*)memory;
+
+    if (core->stream)
+    {
+        freeStream(core->stream);
+        core->stream = NULL;
+    }
+
+    if (frames <= 0)
+        return true;
+
+    tic_sound_stream* stream = calloc(1, sizeof(tic_sound_stream));
+
+    if (!stream)
+        return false;
+
+    stream->depth = frames;
+    for (stream->size = 1; stream->size < frames; stream->size <<= 1);
+
+    // blip can have a sample more or less than the average per frame
+    stream->capacity = core->samplerate / TIC80_FRAMERATE + 2;
+
+    stream->queue = malloc(stream->size * sizeof(SoundFrame));
+    stream->samples = malloc(stream->capacity * TIC_STEREO_CHANNELS * sizeof(s16));
+    stream->blip.left = blip_new(core->samplerate / 10);
+    stream->blip.right = blip_new(core->samplerate / 10);
+
+    if (!stream->queue || !stream->samples || !stream->blip.left || !stream->blip.right)
+    {
+        freeStream(stream);
+        return false;
+    }
+
+    blip_set_rates(stream->blip.left, CLOCKRATE, core->samplerate);
+    blip_set_rates(stream->blip.right, CLOCKRATE, core->samplerate);
+
+    core->stream = stream;
+    return true;
+}
+
+void tic_core_sound_read(tic_mem* memory, s16* samples, s32 count)
+{
+    tic_core* core = (tic_core*)memory;
+    tic_sound_stream* stream = core->stream;
+
+    if (!stream)
+    {
+        memset(samples, 0, count * sizeof(s16));
+        return;
+    }
+
+    while (count >= TIC_STEREO_CHANNELS)
+    {
+        if (stream->pos == stream->count)
+        {
+            s32 tail = stream->tail;
+
+            if (tail != tic_atomic_load(&stream->head))
+            {
+                stream->frame = stream->queue[tail & (stream->size - 1)];
+                stream->starved = 0;
+                tic_atomic_store(&stream->tail, tail + 1);
+            }
+            else if (++stream->starved > SOUND_HOLD_FRAMES)
+                memset(stream->frame.registers, 0, sizeof stream->frame.registers);
+
+            // all the available samples are read, so rates which are not
+            // a multiple of the frame rate don't drift
+            stream->count = synthesize(stream->frame.registers, &stream->frame.stereo, 
+                stream->registers.left, stream->registers.right,
+                stream->blip.left, stream->blip.right, 
+                stream->samples, stream->capacity);
+
+            stream->pos = 0;
+        }
+
+        s32 size = MIN(count / TIC_STEREO_CHANNELS, stream->count - stream->pos);
+
+        memcpy(samples, stream->samples + stream->pos * TIC_STEREO_CHANNELS, size * TIC_STEREO_CHANNELS * sizeof(s16));
+
+        samples += size * TIC_STEREO_CHANNELS;
+        count -= size * TIC_STEREO_CHANNELS;
+        stream->pos += size;
+    }
+
+    if (count > 0)
+        memset(samples, 0, count * sizeof(s16));
+}
+
+bool tic_core_render_sound(s32 samplerate, tic_sound_render* job)
+{
+    // samples are collected in one second chunks before they go to the output
+    enum { ChunkFrames = TIC80_FRAMERATE, Channel = 0 };
+
+    tic_mem* memory = tic_core_create(samplerate);
+
+    if (!memory)
+        return false;
+
+    const s32 frameSamples = memory->samples.size / sizeof(s16);
+    s16* chunk = malloc(frameSamples * ChunkFrames * sizeof(s16));
+
+    if (!chunk)
+    {
+        tic_core_close(memory);
+        return false;
+    }
+
+    memcpy(&memory->ram.sfx, job->sfx, sizeof(tic_sfx));
+    memcpy(&memory->ram.music, job->music, sizeof(tic_music));
+
+    const tic_sound_state* state = &memory->ram.sound_state;
+    const tic_sample* effect = job->track < 0 ? &job->sfx->samples.data[job->index] : NULL;
+
+    if (effect)
+        tic_api_sfx(memory, job->index, effect->note, effect->octave, -1, Channel, MAX_VOLUME, MAX_VOLUME, SFX_DEF_SPEED);
+    else
+        tic_api_music(memory, job->track, -1, -1, false, job->sustain);
+
+    s32 frames = 0;
+
+    for (s32 ticks = 0; effect
+        ? tic_tool_sfx_pos(effect->speed, ticks) < SFX_TICKS
+        : state->flag.music_state == tic_music_play; ticks++)
+    {
+        tic_core_sound_tick_start(memory);
+
+        for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
+            if (job->mute & (1 << i))
+                memory->ram.registers[i].volume = 0;
+
+        tic_core_sound_tick_end(memory);
+
+        memcpy(chunk + frames * frameSamples, memory->samples.buffer, frameSamples * sizeof(s16));
+
+        if (++frames == ChunkFrames)
+        {
+            job->output(job->data, chunk, frames * frameSamples);
+            frames = 0;
+        }
+    }
+
+    if (frames)
+        job->output(job->data, chunk, frames * frameSamples);
+
+    free(chunk);
+    tic_core_close(memory);
+
+    return true;
+}
+
+typedef struct
+{
+    s32 samplerate;
+    tic_sound_render* jobs;
+    s32 count;
+    s32 first;
+    s32 step;
+} RenderWorker;
+
+static void renderWorker(void* data)
+{
+    RenderWorker* worker = data;
+
+    for (s32 i = worker->first; i < worker->count; i += worker->step)
+        worker->jobs[i].done = tic_core_render_sound(worker->samplerate, &worker->jobs[i]);
+}
+
+void tic_core_render_sounds(s32 samplerate, tic_sound_render* jobs, s32 count, s32 threads)
+{
+    enum { MaxThreads = 16 };
+
+    if (threads <= 0)
+        threads = tic_thread_cores();
+
+    threads = MAX(1, MIN(MIN(threads, count), MaxThreads));
+
+    RenderWorker workers[MaxThreads];
+    tic_thread* handles[MaxThreads] = {NULL};
+
+    for (s32 i = 0; i < threads; i++)
+    {
+        workers[i] = (RenderWorker){samplerate, jobs, count, i, threads};
+
+        if (i > 0)
+            handles[i] = tic_thread_create(renderWorker, &workers[i]);
+    }
 
-    stereo_tick_end(memory, core->state.registers.left, core->blip.left, 0);
-    stereo_tick_end(memory, core->state.registers.right, core->blip.right, 1);
+    // the calling thread takes the first share and any share left without a thread
+    renderWorker(&workers[0]);
 
-    blip_read_samples(core->blip.left, core->memory.samples.buffer, core->samplerate / TIC80_FRAMERATE, TIC_STEREO_CHANNELS);
-    blip_read_samples(core->blip.right, core->memory.samples.buffer + 1, core->samplerate / TIC80_FRAMERATE, TIC_STEREO_CHANNELS);
+    for (s32 i = 1; i < threads; i++)
+        handles[i]
+            ? tic_thread_join(handles[i])
+            : renderWorker(&workers[i]);
 }
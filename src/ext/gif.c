@@ -285,6 +285,112 @@ static const u8* toColor(const u8* ptr, gif_color* color)
 	return ptr;
 }
 
+static s32 indexColors(const u8* data, s32 size, u8* screen, gif_color* palette)
+{
+	enum{PalSize = 256};
+
+	s32 colors = 0;
+
+	memset(palette, 0, PalSize * sizeof(gif_color));
+	memset(screen, 0, size);
+
+	for(s32 i = 0; i < size; i++)
+	{
+		if(colors >= PalSize) break;
+
+		gif_color color;
+		toColor(data + i*sizeof(u32), &color);
+
+		// neighbour pixels mostly share the color
+		if(i && colors && memcmp(&palette[screen[i-1]], &color, sizeof(gif_color)) == 0)
+		{
+			screen[i] = screen[i-1];
+			continue;
+		}
+
+		bool found = false;
+		for(s32 c = 0; c < colors; c++)
+		{
+			if(memcmp(&palette[c], &color, sizeof(gif_color)) == 0)
+			{
+				found = true;
+				screen[i] = c;
+				break;
+			}
+		}
+
+		if(!found)
+		{
+			// TODO: check for last color in palette and try to find closest color
+			screen[i] = colors;
+			memcpy(&palette[colors], &color, sizeof(gif_color));
+			colors++;
+		}
+	}
+
+	return colors;
+}
+
+s32 gif_index_frame(const u8* data, s32 size, u8* screen, gif_color* palette)
+{
+	return indexColors(data, size, screen, palette);
+}
+
+static bool putFrame(GifFileType* gif, s32 width, s32 height, s32 scale, const u8* screen, const gif_color* palette, s32 colors, s32 delay, u8* line)
+{
+	enum{Bpp = 8, PalSize = 1 << Bpp, PalStructSize = PalSize * sizeof(gif_color)};
+
+	s32 error = 0;
+	s32 swidth = width*scale, sheight = height*scale;
+
+	{
+		GraphicsControlBlock gcb = 
+		{
+			.DisposalMode = DISPOSE_DO_NOT,
+			.UserInputFlag = false,
+			.DelayTime = delay,
+			.TransparentColor = -1,
+		};
+
+		u8 ext[4];
+		EGifGCBToExtension(&gcb, ext);
+		EGifPutExtension(gif, GRAPHICS_EXT_FUNC_CODE, sizeof ext, ext);
+	}
+
+	ColorMapObject* colorMap = GifMakeMapObject(PalSize, NULL);
+	memset(colorMap->Colors, 0, PalStructSize);
+	memcpy(colorMap->Colors, palette, colors * sizeof(GifColorType));
+
+	if(EGifPutImageDesc(gif, 0, 0, swidth, sheight, false, colorMap) != GIF_ERROR)
+	{
+		for(s32 y = 0; y < height; y++)
+		{
+			for(s32 x = 0, pos = y*width; x < width; x++, pos++)
+			{
+				u8 color = screen[pos];
+				for(s32 s = 0, pos = x*scale; s < scale; s++, pos++)
+					line[pos] = color;
+			}
+
+			for(s32 s = 0; s < scale; s++)
+			{
+				if (EGifPutLine(gif, line, swidth) == GIF_ERROR)
+				{
+					error = gif->Error;
+					break;
+				}
+			}
+
+			if(error != E_GIF_SUCCEEDED) break;
+		}
+	}
+	else error = gif->Error;
+
+	GifFreeMapObject(colorMap);
+
+	return error == E_GIF_SUCCEEDED;
+}
+
 bool gif_write_animation(const void* buffer, s32* size, s32 width, s32 height, const u8* data, s32 frames, s32 fps, s32 scale)
 {
 	bool result = false;
@@ -319,88 +425,11 @@ bool gif_write_animation(const void* buffer, s32* size, s32 width, s32 height, c
 					if(frame >= frames)
 						break;
 
-					s32 colors = 0;
-					const u8* ptr = data + frameSize*frame*sizeof(u32);
-					
-					{
-						memset(palette, 0, PalStructSize);
-						memset(screen, 0, frameSize);
-
-						for(s32 i = 0; i < frameSize; i++)
-						{
-							if(colors >= PalSize) break;
+					s32 colors = indexColors(data + frameSize*frame*sizeof(u32), frameSize, screen, palette);
 
-							gif_color color;
-							toColor(ptr + i*sizeof(u32), &color);
+					result = putFrame(gif, width, height, scale, screen, palette, colors, MinDelay, line);
 
-							bool found = false;
-							for(s32 c = 0; c < colors; c++)
-							{
-								if(memcmp(&palette[c], &color, sizeof(gif_color)) == 0)
-								{
-									found = true;
-									screen[i] = c;
-									break;
-								}
-							}
-
-							if(!found)
-							{
-								// TODO: check for last color in palette and try to find closest color
-								screen[i] = colors;
-								memcpy(&palette[colors], &color, sizeof(gif_color));
-								colors++;
-							}
-						}
-					}
-
-					{
-						GraphicsControlBlock gcb = 
-						{
-							.DisposalMode = DISPOSE_DO_NOT,
-							.UserInputFlag = false,
-							.DelayTime = MinDelay,
-							.TransparentColor = -1,
-						};
-
-						u8 ext[4];
-						EGifGCBToExtension(&gcb, ext);
-						EGifPutExtension(gif, GRAPHICS_EXT_FUNC_CODE, sizeof ext, ext);
-					}
-
-					ColorMapObject* colorMap = GifMakeMapObject(PalSize, NULL);
-					memset(colorMap->Colors, 0, PalStructSize);
-					memcpy(colorMap->Colors, palette, colors * sizeof(GifColorType));
-
-					if(EGifPutImageDesc(gif, 0, 0, swidth, sheight, false, colorMap) != GIF_ERROR)
-					{
-						for(s32 y = 0; y < height; y++)
-						{
-							for(s32 x = 0, pos = y*width; x < width; x++, pos++)
-							{
-								u8 color = screen[pos];
-								for(s32 s = 0, pos = x*scale; s < scale; s++, pos++)
-									line[pos] = color;
-							}
-
-							for(s32 s = 0; s < scale; s++)
-							{
-								if (EGifPutLine(gif, line, swidth) == GIF_ERROR)
-								{
-									error = gif->Error;
-									break;
-								}
-							}
-
-							if(error != E_GIF_SUCCEEDED) break;
-						}
-
-						*size = output.pos;
-
-						result = error == E_GIF_SUCCEEDED;
-					}
-
-					GifFreeMapObject(colorMap);
+					*size = output.pos;
 
 					if(!result)
 						break;
@@ -418,4 +447,110 @@ bool gif_write_animation(const void* buffer, s32* size, s32 width, s32 height, c
 	}
 
 	return result;
-}
\ No newline at end of file
+}
+
+// streaming encoder, the output is collected in a small buffer and handed
+// to the write callback whenever it fills up
+
+struct gif_stream
+{
+	GifFileType* gif;
+	gif_stream_write write;
+	void* data;
+
+	s32 width;
+	s32 height;
+	s32 scale;
+	u8* line;
+
+	bool error;
+	s32 pos;
+	u8 buffer[64 * 1024];
+};
+
+static bool flushStream(gif_stream* stream)
+{
+	if(stream->pos && !stream->error)
+		stream->error = !stream->write(stream->buffer, stream->pos, stream->data);
+
+	stream->pos = 0;
+
+	return !stream->error;
+}
+
+static int writeStream(GifFileType* gif, const GifByteType* data, int size)
+{
+	gif_stream* stream = (gif_stream*)gif->UserData;
+
+	for(s32 left = size; left > 0;)
+	{
+		s32 count = sizeof stream->buffer - stream->pos;
+		if(count > left) count = left;
+
+		memcpy(stream->buffer + stream->pos, data, count);
+		stream->pos += count;
+		data += count;
+		left -= count;
+
+		if(stream->pos == sizeof stream->buffer && !flushStream(stream))
+			return 0;
+	}
+
+	return size;
+}
+
+gif_stream* gif_stream_open(gif_stream_write write, void* data, s32 width, s32 height, s32 scale)
+{
+	enum{Bpp = 8};
+
+	gif_stream* stream = (gif_stream*)calloc(1, sizeof(gif_stream));
+
+	if(stream)
+	{
+		s32 error = 0;
+
+		stream->write = write;
+		stream->data = data;
+		stream->width = width;
+		stream->height = height;
+		stream->scale = scale;
+		stream->line = malloc(width * scale);
+		stream->gif = EGifOpen(stream, writeStream, &error);
+
+		if(stream->line && stream->gif)
+		{
+			EGifSetGifVersion(stream->gif, true);
+
+			if(EGifPutScreenDesc(stream->gif, width * scale, height * scale, Bpp, 0, NULL) != GIF_ERROR && AddLoop(stream->gif))
+				return stream;
+		}
+
+		stream->error = true;
+		gif_stream_close(stream);
+	}
+
+	return NULL;
+}
+
+bool gif_stream_frame(gif_stream* stream, const u8* screen, const gif_color* palette, s32 colors, s32 delay)
+{
+	if(!stream->error && !putFrame(stream->gif, stream->width, stream->height, stream->scale, screen, palette, colors, delay, stream->line))
+		stream->error = true;
+
+	return !stream->error;
+}
+
+bool gif_stream_close(gif_stream* stream)
+{
+	s32 error = 0;
+
+	if(stream->gif && EGifCloseFile(stream->gif, &error) == GIF_ERROR)
+		stream->error = true;
+
+	bool result = flushStream(stream);
+
+	free(stream->line);
+	free(stream);
+
+	return result;
+}
@@ -47,3 +47,13 @@ gif_image* gif_read_data(const void* buffer, s32 size);
 bool gif_write_data(const void* buffer, s32* size, s32 width, s32 height, const u8* data, const gif_color* palette, u8 bpp);
 bool gif_write_animation(const void* buffer, s32* size, s32 width, s32 height, const u8* data, s32 frames, s32 fps, s32 scale);
 void gif_close(gif_image* image);
+
+// RGBA frame to 8 bit indices, returns the number of palette colors
+s32 gif_index_frame(const u8* data, s32 size, u8* screen, gif_color* palette);
+
+typedef struct gif_stream gif_stream;
+typedef bool(*gif_stream_write)(const u8* data, s32 size, void* userdata);
+
+gif_stream* gif_stream_open(gif_stream_write write, void* data, s32 width, s32 height, s32 scale);
+bool gif_stream_frame(gif_stream* stream, const u8* screen, const gif_color* palette, s32 colors, s32 delay);
+bool gif_stream_close(gif_stream* stream);
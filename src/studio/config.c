@@ -48,6 +48,26 @@ static void readConfigVideoScale(Config* config, lua_State* lua)
     lua_pop(lua, 1);
 }
 
+static void readConfigCpuBudget(Config* config, lua_State* lua)
+{
+    lua_getglobal(lua, "CPU_BUDGET");
+
+    if(lua_isinteger(lua, -1))
+        config->data.cpuBudget = lua_tointeger(lua, -1);
+
+    lua_pop(lua, 1);
+}
+
+static void readConfigScriptMemory(Config* config, lua_State* lua)
+{
+    lua_getglobal(lua, "SCRIPT_MEMORY");
+
+    if(lua_isinteger(lua, -1))
+        config->data.scriptMemory = (s32)lua_tointeger(lua, -1);
+
+    lua_pop(lua, 1);
+}
+
 static void readConfigCheckNewVersion(Config* config, lua_State* lua)
 {
     lua_getglobal(lua, "CHECK_NEW_VERSION");
@@ -68,6 +88,16 @@ static void readConfigNoSound(Config* config, lua_State* lua)
     lua_pop(lua, 1);
 }
 
+static void readConfigAudioThread(Config* config, lua_State* lua)
+{
+    lua_getglobal(lua, "AUDIO_THREAD");
+
+    if(lua_isboolean(lua, -1))
+        config->data.audioThread = lua_toboolean(lua, -1);
+
+    lua_pop(lua, 1);
+}
+
 static void readConfigUiScale(Config* config, lua_State* lua)
 {
     lua_getglobal(lua, "UI_SCALE");
@@ -281,8 +311,11 @@ static void readConfig(Config* config)
         {
             readConfigVideoLength(config, lua);
             readConfigVideoScale(config, lua);
+            readConfigCpuBudget(config, lua);
+            readConfigScriptMemory(config, lua);
             readConfigCheckNewVersion(config, lua);
             readConfigNoSound(config, lua);
+            readConfigAudioThread(config, lua);
 #if defined(CRT_SHADER_SUPPORT)            
             readConfigCrtMonitor(config, lua);
             readConfigCrtShader(config, lua);
@@ -23,6 +23,7 @@
 #include "studio.h"
 #include "fs.h"
 #include "net.h"
+#include "thread.h"
 
 #if defined(BAREMETALPI) || defined(_3DS)
   #ifdef EN_DEBUG
@@ -57,11 +58,17 @@
 
 static const char* PublicDir = TIC_HOST;
 
+typedef struct EnumJob EnumJob;
+
 struct FileSystem
 {
     char dir[TICNAME_MAX];
     char work[TICNAME_MAX];
     Net* net;
+    EnumJob* jobs;
+
+    // cancelled jobs waiting for their workers to stop
+    EnumJob* reap;
 };
 
 #if defined(__EMSCRIPTEN__)
@@ -401,6 +408,225 @@ static void enumFiles(FileSystem* fs, const char* path, ListCallback callback, v
 #endif
 }
 
+// local folders are enumerated on a worker thread, entries are passed back
+// in batches and delivered to the callbacks from fsTick on the main thread
+
+#define ENUM_BATCH_SIZE 64
+
+typedef struct EnumBatch EnumBatch;
+
+struct EnumBatch
+{
+    EnumBatch* next;
+    s32 count;
+
+    struct
+    {
+        char* name;
+        bool dir;
+    } items[ENUM_BATCH_SIZE];
+};
+
+struct EnumJob
+{
+    char path[TICNAME_MAX];
+    ListCallback item;
+    DoneCallback done;
+    void* data;
+
+    tic_thread* thread;
+    volatile s32 cancel;
+    volatile s32 finished;
+
+    // published batch count, the consumer keeps the last consumed batch as
+    // a sentinel so the producer never links to a freed node
+    volatile s32 produced;
+    s32 consumed;
+    EnumBatch* head;
+    EnumBatch* tail;
+    EnumBatch* batch;
+
+    EnumJob* next;
+};
+
+static void publishEnumBatch(EnumJob* job)
+{
+    if(job->batch->count)
+    {
+        job->tail->next = job->batch;
+        job->tail = job->batch;
+        job->batch = calloc(1, sizeof(EnumBatch));
+
+        tic_atomic_store(&job->produced, job->produced + 1);
+    }
+}
+
+static bool onEnumWorkerItem(const char* name, const char* info, s32 id, void* data, bool dir)
+{
+    EnumJob* job = data;
+
+    if(!job->batch)
+        return false;
+
+    s32 index = job->batch->count++;
+    job->batch->items[index].name = strdup(name);
+    job->batch->items[index].dir = dir;
+
+    if(job->batch->count == ENUM_BATCH_SIZE)
+        publishEnumBatch(job);
+
+    return !tic_atomic_load(&job->cancel);
+}
+
+static void enumWorker(void* data)
+{
+    EnumJob* job = data;
+
+    enumFiles(NULL, job->path, onEnumWorkerItem, job, true);
+
+    if(job->batch && !tic_atomic_load(&job->cancel))
+    {
+        // folders go out first so they show up before the file list
+        publishEnumBatch(job);
+        enumFiles(NULL, job->path, onEnumWorkerItem, job, false);
+    }
+
+    if(job->batch)
+        publishEnumBatch(job);
+
+    tic_atomic_store(&job->finished, 1);
+}
+
+static void freeEnumBatch(EnumBatch* batch)
+{
+    for(s32 i = 0; i < batch->count; i++)
+        free(batch->items[i].name);
+
+    free(batch);
+}
+
+static void freeEnumJob(EnumJob* job)
+{
+    for(EnumBatch *batch = job->head, *next; batch; batch = next)
+    {
+        next = batch->next;
+        freeEnumBatch(batch);
+    }
+
+    if(job->batch)
+        freeEnumBatch(job->batch);
+
+    free(job);
+}
+
+// delivers the published batches, returns true when the job is complete
+static bool processEnumJob(EnumJob* job)
+{
+    bool finished = tic_atomic_load(&job->finished);
+
+    for(s32 produced = tic_atomic_load(&job->produced); job->consumed < produced; job->consumed++)
+    {
+        EnumBatch* batch = job->head->next;
+        freeEnumBatch(job->head);
+        job->head = batch;
+
+        for(s32 i = 0; i < batch->count && !job->cancel; i++)
+            if(!job->item(batch->items[i].name, NULL, 0, job->data, batch->items[i].dir))
+                tic_atomic_store(&job->cancel, 1);
+    }
+
+    return finished && job->consumed == tic_atomic_load(&job->produced);
+}
+
+static void finishEnumJob(EnumJob* job)
+{
+    if(job->thread)
+        tic_thread_join(job->thread);
+
+    job->done(job->data);
+    freeEnumJob(job);
+}
+
+static void reapEnumJobs(FileSystem* fs, bool wait)
+{
+    for(EnumJob** ptr = &fs->reap; *ptr;)
+    {
+        EnumJob* job = *ptr;
+
+        if(wait || tic_atomic_load(&job->finished))
+        {
+            *ptr = job->next;
+
+            if(job->thread)
+                tic_thread_join(job->thread);
+
+            freeEnumJob(job);
+        }
+        else ptr = &job->next;
+    }
+}
+
+void fsTick(FileSystem* fs)
+{
+    for(EnumJob** ptr = &fs->jobs; *ptr;)
+    {
+        EnumJob* job = *ptr;
+
+        if(processEnumJob(job))
+        {
+            *ptr = job->next;
+            finishEnumJob(job);
+        }
+        else ptr = &job->next;
+    }
+
+    reapEnumJobs(fs, false);
+}
+
+// stops the running enumerations, their done callbacks are called right away
+// with the entries received so far, the workers are joined by fsTick once
+// they notice the cancel flag
+static void cancelEnumJobs(FileSystem* fs)
+{
+    while(fs->jobs)
+    {
+        EnumJob* job = fs->jobs;
+        fs->jobs = job->next;
+
+        tic_atomic_store(&job->cancel, 1);
+        job->done(job->data);
+
+        job->next = fs->reap;
+        fs->reap = job;
+    }
+}
+
+static bool enumFilesAsync(FileSystem* fs, const char* path, ListCallback onItem, DoneCallback onDone, void* data)
+{
+    EnumJob* job = calloc(1, sizeof(EnumJob));
+
+    if(job)
+    {
+        strcpy(job->path, path);
+        job->item = onItem;
+        job->done = onDone;
+        job->data = data;
+        job->head = job->tail = calloc(1, sizeof(EnumBatch));
+        job->batch = calloc(1, sizeof(EnumBatch));
+
+        if(job->head && job->batch && (job->thread = tic_thread_create(enumWorker, job)))
+        {
+            job->next = fs->jobs;
+            fs->jobs = job;
+            return true;
+        }
+
+        freeEnumJob(job);
+    }
+
+    return false;
+}
+
 void fsEnumFilesAsync(FileSystem* fs, ListCallback onItem, DoneCallback onDone, void* data)
 {
     if (isRoot(fs) && !onItem(PublicDir, NULL, 0, data, true))
@@ -422,6 +648,10 @@ void fsEnumFilesAsync(FileSystem* fs, ListCallback onItem, DoneCallback onDone,
 
     const char* path = fsGetFilePath(fs, "");
 
+    if(enumFilesAsync(fs, path, onItem, onDone, data))
+        return;
+
+    // no worker threads, enumerate in place
     enumFiles(fs, path, onItem, data, true);
     enumFiles(fs, path, onItem, data, false);
 
@@ -454,15 +684,13 @@ bool fsDeleteDir(FileSystem* fs, const char* name)
 #endif
 }
 
-bool fsDeleteFile(FileSystem* fs, const char* name)
+static bool deleteFile(const char* path)
 {
 #if defined(BAREMETALPI)
-    dbg("fsDeleteFile %s", name);
+    dbg("fsDeleteFile %s", path);
     // TODO BAREMETALPI
     return false;
 #else
-    const char* path = fsGetFilePath(fs, name);
-
     const FsString* pathString = utf8ToString(path);
     bool result = tic_remove(pathString);
     freeString(pathString);
@@ -475,13 +703,26 @@ bool fsDeleteFile(FileSystem* fs, const char* name)
 #endif
 }
 
+bool fsDeleteFile(FileSystem* fs, const char* name)
+{
+    return deleteFile(fsGetFilePath(fs, name));
+}
+
+bool fsDeleteRootFile(FileSystem* fs, const char* name)
+{
+    return deleteFile(fsGetRootFilePath(fs, name));
+}
+
 void fsHomeDir(FileSystem* fs)
 {
+    cancelEnumJobs(fs);
     memset(fs->work, 0, sizeof fs->work);
 }
 
 void fsDirBack(FileSystem* fs)
 {
+    cancelEnumJobs(fs);
+
     if(isPublicRoot(fs))
     {
         fsHomeDir(fs);
@@ -502,6 +743,8 @@ void fsGetDir(FileSystem* fs, char* dir)
 
 void fsChangeDir(FileSystem* fs, const char* dir)
 {
+    cancelEnumJobs(fs);
+
     if(strlen(fs->work))
         strcat(fs->work, "/");
                 
@@ -621,6 +864,43 @@ bool fsWriteFile(const char* name, const void* buffer, s32 size)
 #endif
 }
 
+bool fsAppendFile(const char* name, const void* buffer, s32 size)
+{
+#if defined(BAREMETALPI)
+    dbg("fsAppendFile %s\n", name);
+    FIL File;
+    FRESULT res = f_open (&File, name, FA_WRITE | FA_OPEN_APPEND);
+    if (res != FR_OK)
+    {
+        return false;
+    }
+
+    u32 written=0;
+    res = f_write(&File, buffer, size, &written);
+    f_close(&File);
+
+    return res == FR_OK && written == size;
+#else
+    const FsString* pathString = utf8ToString(name);
+    FILE* file = tic_fopen(pathString, _S("ab"));
+    freeString(pathString);
+
+    if(file)
+    {
+        bool result = fwrite(buffer, 1, size, file) == size;
+        fclose(file);
+
+#if defined(__EMSCRIPTEN__)
+        syncfs();
+#endif
+
+        return result;
+    }
+
+    return false;
+#endif
+}
+
 void* fsReadFile(const char* path, s32* size)
 {
 #if defined(BAREMETALPI)
@@ -1029,3 +1309,10 @@ FileSystem* createFileSystem(const char* path, Net* net)
 
     return fs;
 }
+
+void fsClose(FileSystem* fs)
+{
+    cancelEnumJobs(fs);
+    reapEnumJobs(fs, true);
+    free(fs);
+}
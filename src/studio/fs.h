@@ -34,12 +34,15 @@ typedef struct FileSystem FileSystem;
 struct Net;
 
 FileSystem* createFileSystem(const char* path, struct Net* net);
+void fsClose(FileSystem* fs);
+void fsTick(FileSystem* fs);
 
 void fsEnumFilesAsync(FileSystem* fs, ListCallback onItem, DoneCallback onDone, void* data);
 void fsIsDirAsync(FileSystem* fs, const char* name, IsDirCallback callback, void* data);
 void fsLoadFileByHashAsync(FileSystem* fs, const char* hash, LoadCallback callback, void* data);
 
 bool fsDeleteFile(FileSystem* fs, const char* name);
+bool fsDeleteRootFile(FileSystem* fs, const char* name);
 bool fsDeleteDir(FileSystem* fs, const char* name);
 bool fsSaveFile(FileSystem* fs, const char* name, const void* data, s32 size, bool overwrite);
 bool fsSaveRootFile(FileSystem* fs, const char* name, const void* data, s32 size, bool overwrite);
@@ -56,6 +59,7 @@ void fsFilename(const char *path, char* out);
 bool fsExists(const char* name);
 void* fsReadFile(const char* path, s32* size);
 bool fsWriteFile(const char* path, const void* data, s32 size);
+bool fsAppendFile(const char* path, const void* data, s32 size);
 void fsOpenWorkingFolder(FileSystem* fs);
 bool fsIsDir(FileSystem* fs, const char* dir);
 bool fsIsInPublicDir(FileSystem* fs);
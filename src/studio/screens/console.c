@@ -410,24 +410,65 @@ static bool onConsoleLoadSectionCommand(Console* console, const char* param)
 
                 if(data)
                 {
-                    tic_cartridge* cart = (tic_cartridge*)malloc(sizeof(tic_cartridge));
+                    tic_mem* tic = console->tic;
 
-                    if(cart)
+                    // sections are taken from the chunks directly, only the
+                    // code needs the whole cart to be loaded to join its banks
+                    tic_cart_index index;
+                    tic_cart_scan(&index, data, size);
+
+                    if(i == 0)
+                    {
+                        const tic_cart_chunk* cover = tic_cart_get_chunk(&index, CHUNK_COVER, 0);
+
+                        memset(&tic->cart.cover, 0, sizeof tic->cart.cover);
+
+                        if(cover)
+                        {
+                            memcpy(tic->cart.cover.data, cover->data, MIN(cover->size, sizeof tic->cart.cover.data));
+                            tic->cart.cover.size = cover->size;
+                        }
+
+                        result = true;
+                    }
+                    else if(i == 3)
                     {
-                        tic_mem* tic = console->tic;
-                        tic_cart_load(cart, data, size);
+                        tic_cartridge* cart = (tic_cartridge*)malloc(sizeof(tic_cartridge));
 
-                        switch(i)
+                        if(cart)
                         {
-                        case 0: memcpy(&tic->cart.cover,            &cart->cover,           sizeof cart->cover); break;
-                        case 1: memcpy(&tic->cart.bank0.tiles,      &cart->bank0.tiles,     sizeof(tic_tiles)*2); break;
-                        case 2: memcpy(&tic->cart.bank0.map,        &cart->bank0.map,       sizeof(tic_map)); break;
-                        case 3: memcpy(&tic->cart.code,             &cart->code,            sizeof(tic_code)); break;
-                        case 4: memcpy(&tic->cart.bank0.sfx,        &cart->bank0.sfx,       sizeof(tic_sfx)); break;
-                        case 5: memcpy(&tic->cart.bank0.music,      &cart->bank0.music,     sizeof(tic_music)); break;
-                        case 6: memcpy(&tic->cart.bank0.palette,    &cart->bank0.palette,   sizeof(tic_palette)); break;
+                            tic_cart_load(cart, data, size);
+                            memcpy(&tic->cart.code, &cart->code, sizeof(tic_code));
+                            free(cart);
+
+                            result = true;
+                        }
+                    }
+                    else
+                    {
+                        tic_bank* bank = (tic_bank*)malloc(sizeof(tic_bank));
+
+                        if(bank)
+                        {
+                            tic_cart_load_bank(bank, &index, 0);
+
+                            switch(i)
+                            {
+                            case 1: memcpy(&tic->cart.bank0.tiles,      &bank->tiles,       sizeof(tic_tiles)*2); break;
+                            case 2: memcpy(&tic->cart.bank0.map,        &bank->map,         sizeof(tic_map)); break;
+                            case 4: memcpy(&tic->cart.bank0.sfx,        &bank->sfx,         sizeof(tic_sfx)); break;
+                            case 5: memcpy(&tic->cart.bank0.music,      &bank->music,       sizeof(tic_music)); break;
+                            case 6: memcpy(&tic->cart.bank0.palette,    &bank->palette,     sizeof(tic_palette)); break;
+                            }
+
+                            free(bank);
+
+                            result = true;
                         }
+                    }
 
+                    if(result)
+                    {
                         studioRomLoaded();
 
                         printLine(console);
@@ -435,10 +476,6 @@ static bool onConsoleLoadSectionCommand(Console* console, const char* param)
                         printBack(console, " loaded from ");
                         printFront(console, name);
                         printLine(console);
-
-                        free(cart);
-
-                        result = true;
                     }
 
                     free(data);
@@ -1571,18 +1608,30 @@ static void exportCover(Console* console, const char* filename)
     commandDone(console);
 }
 
-static void exportSfx(Console* console, s32 sfx, const char* filename)
+static void onSoundExported(void* data, const char* filename, bool done, s32 left)
 {
-    const char* path = studioExportSfx(sfx, filename);
+    Console* console = data;
 
-    if(path)
+    if(done)
     {
         printLine(console);
         printBack(console, filename);
         printBack(console, " exported :)");
-        commandDone(console);
     }
     else
+    {
+        printError(console, "\nerror: ");
+        printError(console, filename);
+        printError(console, " not exported :(");
+    }
+
+    if(left == 0)
+        commandDone(console);
+}
+
+static void exportSfx(Console* console, s32 sfx, const char* filename)
+{
+    if(!studioExportSfx(sfx, filename, onSoundExported, console))
     {
         printError(console, "\nsfx exporting error :(");
         commandDone(console);
@@ -1591,19 +1640,26 @@ static void exportSfx(Console* console, s32 sfx, const char* filename)
 
 static void exportMusic(Console* console, s32 track, const char* filename)
 {
-    const char* path = studioExportMusic(track, filename);
-
-    if(path)
+    if(!studioExportMusic(track, filename, onSoundExported, console))
     {
-        printLine(console);
-        printBack(console, filename);
-        printBack(console, " exported :)");
-
+        printError(console, "\nmusic exporting error :(");
         commandDone(console);
     }
-    else
+}
+
+static void exportTracks(Console* console, const char* filename)
+{
+    char name[TICNAME_MAX];
+    snprintf(name, sizeof name, "%s", filename);
+
+    // files are numbered by track, so the extension goes after the number
+    char* ext = strrchr(name, '.');
+    if(ext && strcmp(ext, ".wav") == 0)
+        *ext = '\0';
+
+    if(!studioExportTracks(name, onSoundExported, console))
     {
-        printError(console, "\nmusic exporting error :(");
+        printError(console, "\nno music tracks exported :(");
         commandDone(console);
     }
 }
@@ -1957,6 +2013,8 @@ static void onConsoleExportCommand(Console* console, const char* param)
             exportMap(console, getFilename(filename, ".map"));
         else if(strcmp(param, "cover") == 0)
             exportCover(console, getFilename(filename, ".gif"));
+        else if(strcmp(param, "tracks") == 0)
+            exportTracks(console, filename);
         else if(strncmp(param, "sfx", SfxIndex) == 0)
             exportSfx(console, atoi(param + SfxIndex) % SFX_COUNT, getFilename(filename, ".wav"));
         else if(strncmp(param, "music", MusicIndex) == 0)
@@ -1979,7 +2037,7 @@ static void onConsoleExportCommand(Console* console, const char* param)
     else
     {
         printBack(console, "\nusage: export (");
-        printFront(console, "win linux rpi mac html sprites map cover sfx<#> music<#>");
+        printFront(console, "win linux rpi mac html sprites map cover sfx<#> music<#> tracks");
         printBack(console, ") file\n");
         commandDone(console);
     }
@@ -1993,41 +2051,38 @@ static CartSaveResult saveCartName(Console* console, const char* name)
 
     if(name && strlen(name))
     {
-        u8* buffer = (u8*)malloc(sizeof(tic_cartridge) * 3);
-
-        if(buffer)
+        if(strcmp(name, CONFIG_TIC_PATH) == 0)
         {
-            if(strcmp(name, CONFIG_TIC_PATH) == 0)
-            {
-                console->config->save(console->config);
-                studioRomSaved();
-                free(buffer);
-                return CART_SAVE_OK;
-            }
-            else
-            {
-                s32 size = 0;
+            console->config->save(console->config);
+            studioRomSaved();
+            return CART_SAVE_OK;
+        }
 
-                if(hasProjectExt(name))
-                {
-                    size = tic_project_save(name, buffer, &tic->cart);
-                }
-                else
-                {
-                    name = getCartName(name);
-                    size = tic_cart_save(&tic->cart, buffer);
-                }
+        u8* buffer = NULL;
+        s32 size = 0;
 
-                if(size && fsSaveFile(console->fs, name, buffer, size, true))
-                {
-                    setCartName(console, name, fsGetFilePath(console->fs, name));
-                    success = true;
-                    studioRomSaved();
-                }
-            }
+        if(hasProjectExt(name))
+        {
+            if((buffer = (u8*)malloc(sizeof(tic_cartridge) * 3)))
+                size = tic_project_save(name, buffer, &tic->cart);
+        }
+        else
+        {
+            name = getCartName(name);
 
-            free(buffer);
+            // the size is known up front, only the exact output is allocated
+            if((size = tic_cart_save_size(console->saver, &tic->cart)) && (buffer = (u8*)malloc(size)))
+                size = tic_cart_save_buffer(console->saver, buffer, size);
         }
+
+        if(buffer && size && fsSaveFile(console->fs, name, buffer, size, true))
+        {
+            setCartName(console, name, fsGetFilePath(console->fs, name));
+            success = true;
+            studioRomSaved();
+        }
+
+        free(buffer);
     }
     else if (strlen(console->rom.name))
     {
@@ -2294,6 +2349,144 @@ static void onConsoleVRamCommand(Console* console, const char* param)
     commandDone(console);
 }
 
+static void onConsoleProfileCommand(Console* console, const char* param)
+{
+    tic_mem* tic = console->tic;
+
+    if(param && (strcmp(param, "on") == 0 || strcmp(param, "off") == 0))
+    {
+        bool enable = strcmp(param, "on") == 0;
+        tic_core_profile(tic, enable);
+
+        printLine(console);
+        printBack(console, enable ? "profiler enabled, run the cart to collect stats" : "profiler disabled");
+        commandDone(console);
+        return;
+    }
+    else if(param)
+    {
+        printLine(console);
+        printError(console, "usage: profile [on|off]");
+        commandDone(console);
+        return;
+    }
+
+    const tic_profile* profile = tic_core_profile_data(tic);
+
+    if(!profile->enabled)
+    {
+        printLine(console);
+        printBack(console, "profiler is off, type 'profile on' to enable");
+        commandDone(console);
+        return;
+    }
+
+    if(!profile->count || !profile->freq)
+    {
+        printLine(console);
+        printBack(console, "no frames recorded yet, run the cart first");
+        commandDone(console);
+        return;
+    }
+
+    printLine(console);
+
+    {
+        char buf[STUDIO_TEXT_BUFFER_WIDTH];
+        snprintf(buf, sizeof buf, "\n|   FRAME PROFILE, LAST %2i FRAMES   |", profile->count);
+
+        printTable(console, "\n+-----------------------------------+");
+        printTable(console, buf);
+        printTable(console, "\n+-------+-------------------+-------+" \
+                            "\n| PHASE | AVG, MS           |MAX, MS|" \
+                            "\n+-------+-------------------+-------+");
+    }
+
+    static const char* Labels[] =
+    {
+#define PROFILE_LABEL_DEF(name, label, ...) label,
+        TIC_PROFILE_LIST(PROFILE_LABEL_DEF)
+#undef PROFILE_LABEL_DEF
+    };
+
+    double totalAvg = 0;
+    u64 totalMax = 0;
+
+    for(s32 phase = 0; phase < tic_profile_count; phase++)
+    {
+        u64 sum = 0, max = 0;
+
+        // completed frames precede the one being recorded
+        for(s32 i = 1; i <= profile->count; i++)
+        {
+            u64 time = profile->frames[(profile->frame - i + TIC_PROFILE_FRAMES) % TIC_PROFILE_FRAMES].time[phase];
+            sum += time;
+            if(time > max) max = time;
+        }
+
+        double avg = sum * 1000.0 / profile->freq / profile->count;
+        double peak = max * 1000.0 / profile->freq;
+
+        totalAvg += avg;
+
+        char buf[STUDIO_TEXT_BUFFER_WIDTH];
+        snprintf(buf, sizeof buf, "\n| %-5s | %-17.3f |%7.3f|", Labels[phase], avg, peak);
+        printTable(console, buf);
+    }
+
+    for(s32 i = 1; i <= profile->count; i++)
+    {
+        const tic_profile_frame* frame = &profile->frames[(profile->frame - i + TIC_PROFILE_FRAMES) % TIC_PROFILE_FRAMES];
+        u64 time = 0;
+
+        for(s32 phase = 0; phase < tic_profile_count; phase++)
+            time += frame->time[phase];
+
+        if(time > totalMax) totalMax = time;
+    }
+
+    {
+        char buf[STUDIO_TEXT_BUFFER_WIDTH];
+        snprintf(buf, sizeof buf, "\n| TOTAL | %-17.3f |%7.3f|", totalAvg, totalMax * 1000.0 / profile->freq);
+
+        printTable(console, "\n+-------+-------------------+-------+");
+        printTable(console, buf);
+        printTable(console, "\n+-------+-------------------+-------+");
+    }
+
+    {
+        s32 rows = 0, maxRows = 0;
+
+        for(s32 i = 1; i <= profile->count; i++)
+        {
+            s32 frameRows = profile->frames[(profile->frame - i + TIC_PROFILE_FRAMES) % TIC_PROFILE_FRAMES].rows;
+            rows += frameRows;
+            if(frameRows > maxRows) maxRows = frameRows;
+        }
+
+        char buf[STUDIO_TEXT_BUFFER_WIDTH];
+        snprintf(buf, sizeof buf, "dirty rows: %.1f%% avg, %i%% max",
+            rows * 100.0 / profile->count / TIC80_HEIGHT, maxRows * 100 / TIC80_HEIGHT);
+
+        printLine(console);
+        printBack(console, buf);
+    }
+
+    {
+        const tic80_script_memory* memory = tic_core_script_memory(tic);
+
+        char buf[STUDIO_TEXT_BUFFER_WIDTH];
+        snprintf(buf, sizeof buf, "script memory: %uK live, %uK peak, %u failed",
+            memory->live / 1024, memory->peak / 1024, memory->failed);
+
+        printLine(console);
+        printBack(console, buf);
+    }
+
+    printLine(console);
+    commandDone(console);
+}
+
 #if defined(CAN_ADDGET_FILE)
 
 static void onConsoleAddFile(Console* console, const char* name, const u8* buffer, s32 size)
@@ -2397,6 +2590,7 @@ static const struct
     {"help",    NULL, "show this info",             onConsoleHelpCommand},
     {"ram",     NULL, "show 96KB RAM layout",        onConsoleRamCommand},
     {"vram",    NULL, "show 16KB VRAM layout",       onConsoleVRamCommand},
+    {"profile", NULL, "show frame profiler stats",  onConsoleProfileCommand},
     {"exit",    "quit", "exit the application",     onConsoleExitCommand},
     {"new",     NULL, "create new cart",            onConsoleNewCommand},
     {"load",    NULL, "load cart",                  onConsoleLoadCommand},
@@ -3027,6 +3221,7 @@ void initConsole(Console* console, tic_mem* tic, FileSystem* fs, Net* net, Confi
     if(!console->buffer) console->buffer = malloc(CONSOLE_BUFFER_SIZE);
     if(!console->colorBuffer) console->colorBuffer = malloc(CONSOLE_BUFFER_SIZE);
     if(!console->embed.file) console->embed.file = malloc(sizeof(tic_cartridge));
+    if(!console->saver) console->saver = tic_cart_saver_create();
 
     *console = (Console)
     {
@@ -3058,6 +3253,7 @@ void initConsole(Console* console, tic_mem* tic, FileSystem* fs, Net* net, Confi
         .active = false,
         .buffer = console->buffer,
         .colorBuffer = console->colorBuffer,
+        .saver = console->saver,
         .fs = fs,
         .net = net,
         .showGameMenu = false,
@@ -3150,6 +3346,7 @@ void freeConsole(Console* console)
     free(console->buffer);
     free(console->colorBuffer);
     free(console->embed.file);
+    tic_cart_saver_delete(console->saver);
 
     {
         HistoryItem* it = console->historyHead;
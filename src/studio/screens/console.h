@@ -72,6 +72,9 @@ struct Console
     char* buffer;
     u8* colorBuffer;
 
+    // reused by every save, keeps the code compression state
+    struct tic_cart_saver* saver;
+
     char inputBuffer[STUDIO_TEXT_BUFFER_WIDTH * STUDIO_TEXT_BUFFER_HEIGHT];
     size_t inputPosition;
 
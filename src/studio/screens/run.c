@@ -126,6 +126,83 @@ static bool forceExit(void* data)
     return tic_api_key(tic, tic_key_escape);
 }
 
+#define SCRIPT_CACHE_SIZE 32
+
+static const char ScriptCacheList[] = TIC_CACHE "luac.list";
+
+static void scriptCachePath(char* path, const char* key, s32 size)
+{
+    snprintf(path, TICNAME_MAX, TIC_CACHE "%.*s.luac", size, key);
+}
+
+// the list keeps the keys of the cached chunks, the most recently used
+// first, chunks falling off the end of the list are deleted
+static void touchScriptCache(Run* run, const char* key)
+{
+    FileSystem* fs = run->console->fs;
+    const s32 len = (s32)strlen(key);
+
+    char* list = malloc(SCRIPT_CACHE_SIZE * (len + 1));
+
+    if(!list)
+        return;
+
+    s32 size = 0, count = 1;
+    char* data = fsLoadRootFile(fs, ScriptCacheList, &size);
+
+    memcpy(list, key, len);
+    list[len] = '\n';
+
+    if(data)
+    {
+        for(const char* ptr = data; ptr + len < data + size && ptr[len] == '\n'; ptr += len + 1)
+        {
+            if(memcmp(ptr, key, len) == 0)
+                continue;
+
+            if(count < SCRIPT_CACHE_SIZE)
+                memcpy(list + (len + 1) * count++, ptr, len + 1);
+            else
+            {
+                char path[TICNAME_MAX];
+                scriptCachePath(path, ptr, len);
+                fsDeleteRootFile(fs, path);
+            }
+        }
+
+        free(data);
+    }
+
+    fsSaveRootFile(fs, ScriptCacheList, list, (len + 1) * count, true);
+    free(list);
+}
+
+static void* loadScriptCache(void* data, const char* key, s32* size)
+{
+    Run* run = (Run*)data;
+
+    char path[TICNAME_MAX];
+    scriptCachePath(path, key, (s32)strlen(key));
+
+    void* buffer = fsLoadRootFile(run->console->fs, path, size);
+
+    if(buffer)
+        touchScriptCache(run, key);
+
+    return buffer;
+}
+
+static void saveScriptCache(void* data, const char* key, const void* buffer, s32 size)
+{
+    Run* run = (Run*)data;
+
+    char path[TICNAME_MAX];
+    scriptCachePath(path, key, (s32)strlen(key));
+
+    if(fsSaveRootFile(run->console->fs, path, buffer, size, true))
+        touchScriptCache(run, key);
+}
+
 static u64 getFreq(void* data)
 {
     return tic_sys_freq_get();
@@ -151,9 +228,13 @@ void initRun(Run* run, Console* console, tic_mem* tic)
             .counter = getCounter,
             .freq = getFreq,
             .start = 0,
+            .budget = MAX(getConfig()->cpuBudget, 0),
+            .memory = (u32)MIN(MAX(getConfig()->scriptMemory, 0), UINT32_MAX / 1024) * 1024,
             .data = run,
             .exit = onExit,
             .forceExit = forceExit,
+            .cacheLoad = loadScriptCache,
+            .cacheSave = saveScriptCache,
         },
     };
 
@@ -25,6 +25,7 @@
 #include "studio/net.h"
 #include "console.h"
 #include "studio/project.h"
+#include "thread.h"
 
 #include "ext/gif.h"
 
@@ -392,74 +393,330 @@ static void resetMenu(Surf* surf)
     surf->menu.anim = 0;
 }
 
-static void updateMenuItemCover(Surf* surf, s32 pos, const u8* cover, s32 size)
+// quantized cover blob stored in the cache: screen followed by per-row palettes
+#define COVER_CACHE_SIZE (sizeof(tic_screen) + TIC80_HEIGHT * sizeof(tic_palette))
+
+typedef struct CoverJob CoverJob;
+
+struct CoverJob
+{
+    s32 pos;
+    char* name;
+    char* hash;
+    char dir[TICNAME_MAX];
+
+    // blob path and cover source, either a file or downloaded gif data
+    char cachePath[TICNAME_MAX];
+    char path[TICNAME_MAX];
+    u8* data;
+    s32 size;
+    bool project;
+    bool remote;
+    tic_rgb bg;
+
+    tic_screen* cover;
+    tic_palette* palettes;
+
+    tic_thread* thread;
+    volatile s32 done;
+    CoverJob* next;
+};
+
+static bool quantizeCover(const gif_image* image, tic_rgb bg, tic_screen* cover, tic_palette* palettes)
 {
-    MenuItem* item = &surf->menu.items[pos];
+    if (image->width != TIC80_WIDTH || image->height != TIC80_HEIGHT)
+        return false;
 
-    if((item->cover = malloc(sizeof(tic_screen))))
+    for(s32 r = 0; r < TIC80_HEIGHT; r++)
     {
-        if((item->palettes = malloc(TIC80_HEIGHT * sizeof(tic_palette))))
+        tic_palette* palette = &palettes[r];
+        s32 colorIndex = 0;
+
+        // init first color with default background
+        palette->colors[0] = bg;
+
+        for(s32 c = 0; c < TIC80_WIDTH; c++)
         {
-            gif_image* image = gif_read_data(cover, size);
+            s32 pixel = r * TIC80_WIDTH + c;
+            const gif_color* rgb = &image->palette[image->buffer[pixel]];
+
+            s32 color = -1;
+            for(s32 i = 0; i <= colorIndex; i++)
+            {
+                const tic_rgb* palColor = &palette->colors[i];
+                if(palColor->r == rgb->r
+                    && palColor->g == rgb->g
+                    && palColor->b == rgb->b)
+                {
+                    color = i;
+                    break;
+                }
+            }
 
-            if(image)
+            if(color < 0)
             {
-                if (image->width == TIC80_WIDTH && image->height == TIC80_HEIGHT)
+                if(colorIndex < TIC_PALETTE_SIZE-1)
                 {
-                    for(s32 r = 0; r < TIC80_HEIGHT; r++)
-                    {
-                        tic_palette* palette = &item->palettes[r];
-                        s32 colorIndex = 0;
-
-                        // init first color with default background
-                        palette->colors[0] = *getConfig()->cart->bank0.palette.scn.colors;
-
-                        for(s32 c = 0; c < TIC80_WIDTH; c++)
-                        {
-                            s32 pixel = r * TIC80_WIDTH + c;
-                            const gif_color* rgb = &image->palette[image->buffer[pixel]];
-
-                            s32 color = -1;
-                            for(s32 i = 0; i <= colorIndex; i++)
-                            {
-                                const tic_rgb* palColor = &palette->colors[i];
-                                if(palColor->r == rgb->r
-                                    && palColor->g == rgb->g
-                                    && palColor->b == rgb->b)
-                                {
-                                    color = i;
-                                    break;
-                                }
-                            }
-
-                            if(color < 0)
-                            {
-                                if(colorIndex < TIC_PALETTE_SIZE-1)
-                                {
-                                    tic_rgb* palColor = &palette->colors[color = ++colorIndex];
-
-                                    palColor->r = rgb->r;
-                                    palColor->g = rgb->g;
-                                    palColor->b = rgb->b;
-                                }
-                                else color = tic_tool_find_closest_color(palette->colors, rgb);
-                            }
-
-                            tic_tool_poke4(item->cover->data, pixel, color);
-                        }
-                    }
+                    tic_rgb* palColor = &palette->colors[color = ++colorIndex];
+
+                    palColor->r = rgb->r;
+                    palColor->g = rgb->g;
+                    palColor->b = rgb->b;
                 }
+                else color = tic_tool_find_closest_color(palette->colors, rgb);
+            }
 
-                gif_close(image);
-            }           
+            tic_tool_poke4(cover->data, pixel, color);
         }
     }
+
+    return true;
+}
+
+static bool decodeCover(CoverJob* job, const u8* data, s32 size)
+{
+    bool done = false;
+    gif_image* image = gif_read_data(data, size);
+
+    if(image)
+    {
+        done = quantizeCover(image, job->bg, job->cover, job->palettes);
+        gif_close(image);
+    }
+
+    return done;
+}
+
+static bool loadCoverSource(CoverJob* job)
+{
+    if(job->data)
+        return decodeCover(job, job->data, job->size);
+
+    s32 size = 0;
+    u8* data = fsReadFile(job->path, &size);
+    bool done = false;
+
+    if(data)
+    {
+        if(job->remote)
+            done = decodeCover(job, data, size);
+        else if(job->project)
+        {
+            tic_cartridge* cart = (tic_cartridge*)malloc(sizeof(tic_cartridge));
+
+            if(cart)
+            {
+                tic_project_load(job->name, (const char*)data, size, cart);
+
+                if(cart->cover.size)
+                    done = decodeCover(job, cart->cover.data, cart->cover.size);
+
+                free(cart);
+            }
+        }
+        else
+        {
+            // only the chunk headers are read, the cover is used in place
+            tic_cart_index index;
+            tic_cart_scan(&index, data, size);
+
+            const tic_cart_chunk* cover = tic_cart_get_chunk(&index, CHUNK_COVER, 0);
+
+            if(cover && cover->size)
+                done = decodeCover(job, cover->data, cover->size);
+        }
+
+        free(data);
+    }
+
+    return done;
+}
+
+// runs on the worker thread, touches only the job and the file system
+static void coverWorker(void* data)
+{
+    CoverJob* job = data;
+    bool done = false;
+
+    job->cover = malloc(sizeof(tic_screen));
+    job->palettes = malloc(TIC80_HEIGHT * sizeof(tic_palette));
+
+    if(job->cover && job->palettes)
+    {
+        if(!job->data)
+        {
+            s32 size = 0;
+            u8* blob = fsReadFile(job->cachePath, &size);
+
+            if(blob)
+            {
+                if(size == COVER_CACHE_SIZE)
+                {
+                    memcpy(job->cover, blob, sizeof(tic_screen));
+                    memcpy(job->palettes, blob + sizeof(tic_screen), TIC80_HEIGHT * sizeof(tic_palette));
+                    done = true;
+                }
+
+                free(blob);
+            }
+        }
+
+        if(!done && (done = loadCoverSource(job)))
+        {
+            u8* blob = malloc(COVER_CACHE_SIZE);
+
+            if(blob)
+            {
+                memcpy(blob, job->cover, sizeof(tic_screen));
+                memcpy(blob + sizeof(tic_screen), job->palettes, TIC80_HEIGHT * sizeof(tic_palette));
+                fsWriteFile(job->cachePath, blob, COVER_CACHE_SIZE);
+                free(blob);
+            }
+        }
+    }
+
+    if(!done)
+    {
+        free(job->cover);
+        free(job->palettes);
+        job->cover = NULL;
+        job->palettes = NULL;
+    }
+
+    tic_atomic_store(&job->done, 1);
+}
+
+static void freeCoverJob(CoverJob* job)
+{
+    free(job->name);
+    free(job->hash);
+    free(job->data);
+    free(job->cover);
+    free(job->palettes);
+    free(job);
+}
+
+// the blob key covers everything the quantized result depends on
+static CoverJob* createCoverJob(Surf* surf, const MenuItem* item, const char* source, u64 mdate)
+{
+    CoverJob* job = calloc(1, sizeof(CoverJob));
+
+    if(job)
+    {
+        job->pos = surf->menu.pos;
+        job->name = strdup(item->name);
+        job->hash = item->hash ? strdup(item->hash) : NULL;
+        job->project = item->project;
+        job->bg = *getConfig()->cart->bank0.palette.scn.colors;
+        fsGetDir(surf->fs, job->dir);
+        strcpy(job->path, source);
+
+        char key[TICNAME_MAX + 32];
+        snprintf(key, sizeof key, "%s:%llu:%02x%02x%02x", 
+            item->hash ? item->hash : source, (unsigned long long)mdate, job->bg.r, job->bg.g, job->bg.b);
+
+        char cachePath[TICNAME_MAX];
+        snprintf(cachePath, sizeof cachePath, TIC_CACHE "%s.cover", md5str(key, (s32)strlen(key)));
+        strcpy(job->cachePath, fsGetRootFilePath(surf->fs, cachePath));
+    }
+
+    return job;
+}
+
+// newest request goes first, so the cover under the cursor is decoded
+// before the ones which were scrolled past
+static void queueCoverJob(Surf* surf, CoverJob* job)
+{
+    job->next = surf->covers.queue;
+    surf->covers.queue = job;
+}
+
+static void requestCover(Surf* surf, const MenuItem* item);
+
+static void applyCoverJob(Surf* surf, CoverJob* job)
+{
+    char dir[TICNAME_MAX];
+    fsGetDir(surf->fs, dir);
+
+    if(strcmp(dir, job->dir) || job->pos >= surf->menu.count)
+        return;
+
+    MenuItem* item = &surf->menu.items[job->pos];
+
+    if(strcmp(item->name, job->name))
+        return;
+
+    if(job->cover && !item->cover)
+    {
+        item->cover = job->cover;
+        item->palettes = job->palettes;
+        job->cover = NULL;
+        job->palettes = NULL;
+    }
+    else if(job->remote && !job->data && !item->cover)
+        requestCover(surf, item);
+}
+
+static void processCoverJobs(Surf* surf)
+{
+    CoverJob* job = surf->covers.active;
+
+    if(job)
+    {
+        if(!tic_atomic_load(&job->done))
+            return;
+
+        if(job->thread)
+            tic_thread_join(job->thread);
+        surf->covers.active = NULL;
+
+        applyCoverJob(surf, job);
+        freeCoverJob(job);
+    }
+
+    if((job = surf->covers.queue))
+    {
+        surf->covers.queue = job->next;
+        surf->covers.active = job;
+
+        // no threads on this platform, decode in place
+        if(!(job->thread = tic_thread_create(coverWorker, job)))
+            coverWorker(job);
+    }
+}
+
+// drops the queued requests, the active one is left to finish and is
+// discarded by applyCoverJob if its item is gone
+static void cancelCoverJobs(Surf* surf)
+{
+    for(CoverJob *job, *next; (job = surf->covers.queue); surf->covers.queue = next)
+    {
+        next = job->next;
+        freeCoverJob(job);
+    }
+}
+
+static void freeCoverJobs(Surf* surf)
+{
+    CoverJob* job = surf->covers.active;
+
+    if(job)
+    {
+        if(job->thread)
+            tic_thread_join(job->thread);
+        freeCoverJob(job);
+    }
+
+    cancelCoverJobs(surf);
+
+    surf->covers.active = NULL;
 }
 
 typedef struct
 {
     Surf* surf;
     s32 pos;
+    char* name;
     char cachePath[TICNAME_MAX];
     char dir[TICNAME_MAX];
 } CoverLoadingData;
@@ -476,48 +733,55 @@ static void coverLoaded(const HttpGetData* netData)
         char dir[TICNAME_MAX];
         fsGetDir(surf->fs, dir);
 
-        if(strcmp(dir, coverLoadingData->dir) == 0)
-            updateMenuItemCover(surf, coverLoadingData->pos, netData->done.data, netData->done.size);
+        s32 pos = coverLoadingData->pos;
+
+        if(strcmp(dir, coverLoadingData->dir) == 0 && pos < surf->menu.count
+            && strcmp(surf->menu.items[pos].name, coverLoadingData->name) == 0)
+        {
+            const MenuItem* item = &surf->menu.items[pos];
+            CoverJob* job = createCoverJob(surf, item, fsGetRootFilePath(surf->fs, coverLoadingData->cachePath), 0);
+
+            if(job)
+            {
+                job->pos = pos;
+                job->remote = true;
+
+                if((job->data = malloc(netData->done.size)))
+                {
+                    memcpy(job->data, netData->done.data, netData->done.size);
+                    job->size = netData->done.size;
+                    queueCoverJob(surf, job);
+                }
+                else freeCoverJob(job);
+            }
+        }
     }
 
     switch (netData->type)
     {
     case HttpGetDone:
     case HttpGetError:
+        free(coverLoadingData->name);
         free(coverLoadingData);
         break;
     }
 }
 
-static void requestCover(Surf* surf, MenuItem* item)
+static void requestCover(Surf* surf, const MenuItem* item)
 {
-    CoverLoadingData coverLoadingData = {surf, surf->menu.pos};
+    CoverLoadingData coverLoadingData = {surf, (s32)(item - surf->menu.items), strdup(item->name)};
     fsGetDir(surf->fs, coverLoadingData.dir);
 
-    const char* hash = item->hash;
-    sprintf(coverLoadingData.cachePath, TIC_CACHE "%s.gif", hash);
-
-    {
-        s32 size = 0;
-        void* data = fsLoadRootFile(surf->fs, coverLoadingData.cachePath, &size);
-
-        if (data)
-        {
-            updateMenuItemCover(surf, surf->menu.pos, data, size);
-            free(data);
-        }
-    }
+    sprintf(coverLoadingData.cachePath, TIC_CACHE "%s.gif", item->hash);
 
     char path[TICNAME_MAX];
-    sprintf(path, "/cart/%s/cover.gif", hash);
+    sprintf(path, "/cart/%s/cover.gif", item->hash);
 
     netGet(surf->net, path, coverLoaded, OBJCOPY(coverLoadingData));
 }
 
 static void loadCover(Surf* surf)
 {
-    tic_mem* tic = surf->tic;
-    
     MenuItem* item = &surf->menu.items[surf->menu.pos];
     
     if(item->coverLoading)
@@ -527,40 +791,36 @@ static void loadCover(Surf* surf)
 
     if(!fsIsInPublicDir(surf->fs))
     {
+        if(item->dir)
+            return;
 
-        s32 size = 0;
-        void* data = fsLoadFile(surf->fs, item->name, &size);
-
-        if(data)
-        {
-            tic_cartridge* cart = (tic_cartridge*)malloc(sizeof(tic_cartridge));
-
-            if(cart)
-            {
-
-                if(hasProjectExt(item->name))
-                    tic_project_load(item->name, data, size, cart);
-                else
-                    tic_cart_load(cart, data, size);
+        char path[TICNAME_MAX];
+        strcpy(path, fsGetFilePath(surf->fs, item->name));
 
-                if(cart->cover.size)
-                    updateMenuItemCover(surf, surf->menu.pos, cart->cover.data, cart->cover.size);
-
-                free(cart);
-            }
-
-            free(data);
-        }
+        CoverJob* job = createCoverJob(surf, item, path, fsMDate(path));
+        if(job) queueCoverJob(surf, job);
     }
     else if(item->hash && !item->cover)
     {
-        requestCover(surf, item);    
+        // try the quantized blob and the downloaded gif first, the
+        // network is asked only if neither of them is cached
+        char gifPath[TICNAME_MAX];
+        sprintf(gifPath, TIC_CACHE "%s.gif", item->hash);
+
+        CoverJob* job = createCoverJob(surf, item, fsGetRootFilePath(surf->fs, gifPath), 0);
+
+        if(job)
+        {
+            job->remote = true;
+            queueCoverJob(surf, job);
+        }
     }
 }
 
 static void initMenuAsync(Surf* surf, DoneCallback callback, void* calldata)
 {
     resetMenu(surf);
+    cancelCoverJobs(surf);
 
     surf->loading = true;
 
@@ -852,6 +1112,8 @@ static void tick(Surf* surf)
         }
     }
 
+    processCoverJobs(surf);
+
     if (surf->menu.count > 0)
     {
         loadCover(surf);
@@ -902,6 +1164,10 @@ static void overline(tic_mem* tic, void* data)
 
 void initSurf(Surf* surf, tic_mem* tic, struct Console* console)
 {
+    // surf is reinitialized on every visit, the previous one is released first
+    freeCoverJobs(surf);
+    resetMenu(surf);
+
     *surf = (Surf)
     {
         .tic = tic,
@@ -930,6 +1196,7 @@ void initSurf(Surf* surf, tic_mem* tic, struct Console* console)
 
 void freeSurf(Surf* surf)
 {
+    freeCoverJobs(surf);
     resetMenu(surf);
     free(surf);
 }
\ No newline at end of file
@@ -47,6 +47,13 @@ struct Surf
         s32 count;
     } menu;
 
+    // cover decoding jobs, one runs on a worker while the rest wait
+    struct
+    {
+        struct CoverJob* active;
+        struct CoverJob* queue;
+    } covers;
+
     void(*tick)(Surf* surf);
     void(*resume)(Surf* surf);
     void (*scanline)(tic_mem* tic, s32 row, void* data);
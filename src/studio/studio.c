@@ -40,6 +40,7 @@
 
 #include "fs.h"
 #include "net.h"
+#include "thread.h"
 
 #include "ext/gif.h"
 #include "ext/md5.h"
@@ -53,6 +54,8 @@
 #include <lualib.h>
 
 #define FRAME_SIZE (TIC80_FULLWIDTH * TIC80_FULLHEIGHT * sizeof(u32))
+#define VIDEO_QUEUE_SIZE 8
+#define VIDEO_DELAY 2 // in 1/100 sec
 #define POPUP_DUR (TIC80_FRAMERATE*2)
 
 #if defined(TIC80_PRO)
@@ -67,6 +70,22 @@
 static const char VideoGif[] = "video%i.gif";
 static const char ScreenGif[] = "screen%i.gif";
 
+typedef struct
+{
+    u8 screen[TIC80_FULLWIDTH * TIC80_FULLHEIGHT];
+    gif_color palette[256];
+    s32 colors;
+} VideoFrame;
+
+typedef struct
+{
+    char filename[TICNAME_MAX];
+    s16* samples;
+    s32 count;
+    s32 capacity;
+    bool failed;
+} SoundBuffer;
+
 typedef struct
 {
     u8 data[MD5_HASHSIZE];
@@ -157,12 +176,42 @@ static struct
     {
         bool record;
 
-        u32* buffer;
         s32 frames;
         s32 frame;
+        s32 written;
+
+        char name[TICNAME_MAX];
+        char path[TICNAME_MAX];
+        gif_stream* gif;
+
+        // indexed frames waiting for the encoder thread
+        VideoFrame* queue;
+        volatile s32 head;
+        volatile s32 tail;
+        volatile s32 stop;
+        tic_thread* thread;
 
     } video;
 
+    // sounds are rendered from a snapshot of the bank on a worker and
+    // written out by the studio tick once all of them are done
+    struct
+    {
+        tic_sfx sfx;
+        tic_music music;
+
+        tic_sound_render* jobs;
+        SoundBuffer* buffers;
+        s32 count;
+
+        StudioExportDone callback;
+        void* data;
+
+        volatile s32 finished;
+        tic_thread* thread;
+
+    } sound;
+
     struct
     {
         Code*       code;
@@ -236,7 +285,7 @@ static struct
     .video =
     {
         .record = false,
-        .buffer = NULL,
+        .queue = NULL,
         .frames = 0,
     },
 };
@@ -284,92 +333,225 @@ static const tic_music* getMusicSrc()
     return &tic->cart.banks[impl.bank.index.music].music;
 }
 
-const char* studioExportSfx(s32 index, const char* filename)
+static void writeSound(void* data, const s16* samples, s32 count)
 {
-    tic_mem* tic = impl.studio.tic;
+    SoundBuffer* buffer = data;
 
-    const char* path = fsGetFilePath(impl.fs, filename);
+    if(buffer->failed)
+        return;
 
-    if(wave_open( impl.samplerate, path ))
+    if(buffer->count + count > buffer->capacity)
     {
+        s32 capacity = MAX(buffer->capacity * 2, buffer->count + count);
+        s16* samples = realloc(buffer->samples, capacity * sizeof(s16));
+
+        if(!samples)
+        {
+            buffer->failed = true;
+            return;
+        }
+
+        buffer->samples = samples;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->samples + buffer->count, samples, count * sizeof(s16));
+    buffer->count += count;
+}
+
+static void soundExporter(void* data)
+{
+    tic_core_render_sounds(impl.samplerate, impl.sound.jobs, impl.sound.count, 0);
+    tic_atomic_store(&impl.sound.finished, 1);
+}
+
+static void freeSoundExport()
+{
+    if(impl.sound.thread)
+        tic_thread_join(impl.sound.thread);
+
+    for(s32 i = 0; i < impl.sound.count; i++)
+        free(impl.sound.buffers[i].samples);
+
+    free(impl.sound.jobs);
+    free(impl.sound.buffers);
+
+    impl.sound.jobs = NULL;
+    impl.sound.buffers = NULL;
+    impl.sound.count = 0;
+    impl.sound.thread = NULL;
+}
+
+static bool saveSound(const SoundBuffer* buffer)
+{
+    if(buffer->failed || !wave_open(impl.samplerate, fsGetFilePath(impl.fs, buffer->filename)))
+        return false;
 
 #if TIC_STEREO_CHANNELS == 2
-        wave_enable_stereo();
+    wave_enable_stereo();
 #endif
 
-        const tic_sfx* sfx = getSfxSrc();
+    if(buffer->count)
+        wave_write(buffer->samples, buffer->count);
 
-        sfx2ram(&tic->ram, sfx);
-        music2ram(&tic->ram, getMusicSrc());
+    wave_close();
 
-        {
-            const tic_sample* effect = &sfx->samples.data[index];
+    return true;
+}
 
-            enum{Channel = 0};
-            sfx_stop(tic, Channel);
-            tic_api_sfx(tic, index, effect->note, effect->octave, -1, Channel, MAX_VOLUME, MAX_VOLUME, SFX_DEF_SPEED);
+static void processSoundExport()
+{
+    if(!impl.sound.jobs || !tic_atomic_load(&impl.sound.finished))
+        return;
 
-            for(s32 ticks = 0, pos = 0; pos < SFX_TICKS; pos = tic_tool_sfx_pos(effect->speed, ++ticks))
-            {
-                tic_core_tick_start(tic);
-                tic_core_tick_end(tic);
+    // the callback may start a new export, so the batch is detached first
+    if(impl.sound.thread)
+        tic_thread_join(impl.sound.thread);
+    impl.sound.thread = NULL;
 
-                wave_write(tic->samples.buffer, tic->samples.size / sizeof(s16));
-            }
+    s32 count = impl.sound.count;
+    tic_sound_render* jobs = impl.sound.jobs;
+    SoundBuffer* buffers = impl.sound.buffers;
+    StudioExportDone callback = impl.sound.callback;
+    void* data = impl.sound.data;
 
-            sfx_stop(tic, Channel);
-            memset(tic->ram.registers, 0, sizeof(tic_sound_register));
-        }
+    impl.sound.jobs = NULL;
+    impl.sound.buffers = NULL;
+    impl.sound.count = 0;
 
-        wave_close();
+    for(s32 i = 0; i < count; i++)
+    {
+        bool done = jobs[i].done && saveSound(&buffers[i]);
+        free(buffers[i].samples);
 
-        return path;
+        callback(data, buffers[i].filename, done, count - i - 1);
     }
 
-    return NULL;
+    free(jobs);
+    free(buffers);
 }
 
-const char* studioExportMusic(s32 track, const char* filename)
+static bool beginSoundExport(s32 count, StudioExportDone callback, void* data)
 {
-    tic_mem* tic = impl.studio.tic;
+    if(impl.sound.jobs)
+        return false;
 
-    const char* path = fsGetFilePath(impl.fs, filename);
+    impl.sound.jobs = calloc(count, sizeof(tic_sound_render));
+    impl.sound.buffers = calloc(count, sizeof(SoundBuffer));
 
-    if(wave_open( impl.samplerate, path ))
+    if(!impl.sound.jobs || !impl.sound.buffers)
     {
-#if TIC_STEREO_CHANNELS == 2
-        wave_enable_stereo();
-#endif
+        freeSoundExport();
+        return false;
+    }
 
-        const tic_sfx* sfx = getSfxSrc();
-        const tic_music* music = getMusicSrc();
+    memcpy(&impl.sound.sfx, getSfxSrc(), sizeof(tic_sfx));
+    memcpy(&impl.sound.music, getMusicSrc(), sizeof(tic_music));
 
-        sfx2ram(&tic->ram, sfx);
-        music2ram(&tic->ram, music);
+    impl.sound.count = count;
+    impl.sound.callback = callback;
+    impl.sound.data = data;
+    impl.sound.finished = 0;
 
-        const tic_sound_state* state = &tic->ram.sound_state;
-        const Music* editor = impl.banks.music[impl.bank.index.music];
+    for(s32 i = 0; i < count; i++)
+    {
+        tic_sound_render* job = &impl.sound.jobs[i];
 
-        tic_api_music(tic, track, -1, -1, false, editor->sustain);
+        job->sfx = &impl.sound.sfx;
+        job->music = &impl.sound.music;
+        job->output = writeSound;
+        job->data = &impl.sound.buffers[i];
+    }
 
-        while(state->flag.music_state == tic_music_play)
-        {
-            tic_core_tick_start(tic);
+    return true;
+}
+
+static void runSoundExport()
+{
+    // without threads the batch is rendered in place and reported on the next tick
+    if(!(impl.sound.thread = tic_thread_create(soundExporter, NULL)))
+        soundExporter(NULL);
+}
+
+static u8 getMusicMute()
+{
+    const Music* editor = impl.banks.music[impl.bank.index.music];
+    u8 mute = 0;
 
-            for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
-                if(!editor->on[i])
-                    tic->ram.registers[i].volume = 0;
+    for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
+        if(!editor->on[i])
+            mute |= 1 << i;
 
-            tic_core_tick_end(tic);
+    return mute;
+}
 
-            wave_write(tic->samples.buffer, tic->samples.size / sizeof(s16));
-        }
+bool studioExportSfx(s32 index, const char* filename, StudioExportDone callback, void* data)
+{
+    if(!beginSoundExport(1, callback, data))
+        return false;
+
+    impl.sound.jobs->track = -1;
+    impl.sound.jobs->index = index;
+    snprintf(impl.sound.buffers->filename, TICNAME_MAX, "%s", filename);
+
+    runSoundExport();
+
+    return true;
+}
 
-        wave_close();        
-        return path;
+bool studioExportMusic(s32 track, const char* filename, StudioExportDone callback, void* data)
+{
+    if(!beginSoundExport(1, callback, data))
+        return false;
+
+    impl.sound.jobs->track = track;
+    impl.sound.jobs->sustain = impl.banks.music[impl.bank.index.music]->sustain;
+    impl.sound.jobs->mute = getMusicMute();
+    snprintf(impl.sound.buffers->filename, TICNAME_MAX, "%s", filename);
+
+    runSoundExport();
+
+    return true;
+}
+
+static bool isTrackEmpty(const tic_track* track)
+{
+    for(s32 i = 0; i < COUNT_OF(track->data); i++)
+        if(track->data[i])
+            return false;
+
+    return true;
+}
+
+s32 studioExportTracks(const char* name, StudioExportDone callback, void* data)
+{
+    const tic_music* music = getMusicSrc();
+    s32 count = 0;
+
+    for(s32 i = 0; i < MUSIC_TRACKS; i++)
+        if(!isTrackEmpty(&music->tracks.data[i]))
+            count++;
+
+    if(count == 0 || !beginSoundExport(count, callback, data))
+        return 0;
+
+    const Music* editor = impl.banks.music[impl.bank.index.music];
+
+    for(s32 i = 0, job = 0; i < MUSIC_TRACKS; i++)
+    {
+        if(isTrackEmpty(&music->tracks.data[i]))
+            continue;
+
+        impl.sound.jobs[job].track = i;
+        impl.sound.jobs[job].sustain = editor->sustain;
+        impl.sound.jobs[job].mute = getMusicMute();
+        snprintf(impl.sound.buffers[job].filename, TICNAME_MAX, "%s-%i.wav", name, i);
+        job++;
     }
 
-    return NULL;
+    runSoundExport();
+
+    return count;
 }
 
 void sfx_stop(tic_mem* tic, s32 channel)
@@ -1444,73 +1626,126 @@ static void setCoverImage()
     }
 }
 
-static void stopVideoRecord(const char* name)
+static bool writeVideo(const u8* data, s32 size, void* userdata)
 {
-    if(impl.video.buffer)
+    return fsAppendFile(impl.video.path, data, size);
+}
+
+static void encodeVideoFrames()
+{
+    for(s32 tail = impl.video.tail, head = tic_atomic_load(&impl.video.head); tail != head; tail++)
     {
-        {
-            s32 size = 0;
-            u8* data = malloc(FRAME_SIZE * impl.video.frame);
-            int i = 0;
-            char filename[TICNAME_MAX];
+        const VideoFrame* frame = &impl.video.queue[tail % VIDEO_QUEUE_SIZE];
+        gif_stream_frame(impl.video.gif, frame->screen, frame->palette, frame->colors, VIDEO_DELAY);
+        tic_atomic_store(&impl.video.tail, tail + 1);
+    }
+}
 
-            gif_write_animation(data, &size, TIC80_FULLWIDTH, TIC80_FULLHEIGHT, (const u8*)impl.video.buffer, impl.video.frame, TIC80_FRAMERATE, getConfig()->gifScale);
+static void videoEncoder(void* data)
+{
+    while(!tic_atomic_load(&impl.video.stop))
+    {
+        encodeVideoFrames();
+        tic_thread_sleep(1);
+    }
 
-            // Find an available filename to save.
-            do
-            {
-                snprintf(filename, sizeof filename, name, ++i);
-            }
-            while(fsExistsFile(impl.fs, filename));
+    encodeVideoFrames();
+}
 
-            // Now that it has found an available filename, save it.
-            if(fsSaveFile(impl.fs, filename, data, size, true))
-            {
-                char msg[TICNAME_MAX];
-                sprintf(msg, "%s saved :)", filename);
-                showPopupMessage(msg);
+static bool finishVideoRecord()
+{
+    bool result = false;
 
-                tic_sys_open_path(fsGetFilePath(impl.fs, filename));
-            }
-            else showPopupMessage("error: file not saved :(");
-        }
+    if(impl.video.gif)
+    {
+        tic_atomic_store(&impl.video.stop, 1);
+
+        if(impl.video.thread)
+            tic_thread_join(impl.video.thread);
+        else encodeVideoFrames();
 
-        free(impl.video.buffer);
-        impl.video.buffer = NULL;
+        result = gif_stream_close(impl.video.gif);
+        impl.video.gif = NULL;
+        impl.video.thread = NULL;
     }
 
+    free(impl.video.queue);
+    impl.video.queue = NULL;
     impl.video.record = false;
+
+    return result;
 }
 
-static void startVideoRecord()
+static void stopVideoRecord()
+{
+    if(finishVideoRecord())
+    {
+        char msg[TICNAME_MAX];
+        sprintf(msg, "%s saved :)", impl.video.name);
+        showPopupMessage(msg);
+
+        tic_sys_open_path(impl.video.path);
+    }
+    else showPopupMessage("error: file not saved :(");
+}
+
+// frames are indexed on capture and encoded on a worker straight into the
+// file, so recording takes a fixed amount of memory for any length
+static void beginVideoRecord(const char* name, s32 frames)
 {
     if(impl.video.record)
+        return;
+
+    s32 i = 0;
+
+    // Find an available filename to save.
+    do
+    {
+        snprintf(impl.video.name, sizeof impl.video.name, name, ++i);
+    }
+    while(fsExistsFile(impl.fs, impl.video.name));
+
+    strcpy(impl.video.path, fsGetFilePath(impl.fs, impl.video.name));
+
+    impl.video.frames = frames;
+    impl.video.frame = 0;
+    impl.video.written = 0;
+    impl.video.head = impl.video.tail = 0;
+    impl.video.stop = 0;
+    impl.video.thread = NULL;
+
+    if(!(impl.video.queue = malloc(sizeof(VideoFrame) * VIDEO_QUEUE_SIZE)))
+        return;
+
+    if(fsWriteFile(impl.video.path, NULL, 0) && (impl.video.gif = 
+        gif_stream_open(writeVideo, NULL, TIC80_FULLWIDTH, TIC80_FULLHEIGHT, getConfig()->gifScale)))
     {
-        stopVideoRecord(VideoGif);
+        impl.video.thread = tic_thread_create(videoEncoder, NULL);
+        impl.video.record = true;
     }
     else
     {
-        impl.video.frames = getConfig()->gifLength * TIC80_FRAMERATE;
-        impl.video.buffer = malloc(FRAME_SIZE * impl.video.frames);
-
-        if(impl.video.buffer)
-        {
-            impl.video.record = true;
-            impl.video.frame = 0;
-        }
+        free(impl.video.queue);
+        impl.video.queue = NULL;
+        showPopupMessage("error: file not saved :(");
     }
 }
 
-static void takeScreenshot()
+static void startVideoRecord()
 {
-    impl.video.frames = 1;
-    impl.video.buffer = malloc(FRAME_SIZE);
-
-    if(impl.video.buffer)
+    if(impl.video.record)
     {
-        impl.video.record = true;
-        impl.video.frame = 0;
+        stopVideoRecord();
     }
+    else
+    {
+        beginVideoRecord(VideoGif, getConfig()->gifLength * TIC80_FRAMERATE);
+    }
+}
+
+static void takeScreenshot()
+{
+    beginVideoRecord(ScreenGif, 1);
 }
 
 static inline bool keyWasPressedOnce(s32 key)
@@ -1674,19 +1909,45 @@ static bool isRecordFrame(void)
     return impl.video.record;
 }
 
+static void captureVideoFrame(const u32* pixels)
+{
+    enum {DelayUnits = 100};
+
+    // gif frames are VIDEO_DELAY long, the closest tick is taken for each
+    s32 written = impl.video.written;
+    if((written * TIC80_FRAMERATE * VIDEO_DELAY * 2 + 1) / (2 * DelayUnits) != impl.video.frame)
+        return;
+
+    s32 head = impl.video.head;
+
+    // the encoder is behind, wait for a free slot
+    while(head - tic_atomic_load(&impl.video.tail) >= VIDEO_QUEUE_SIZE)
+        tic_thread_sleep(1);
+
+    VideoFrame* frame = &impl.video.queue[head % VIDEO_QUEUE_SIZE];
+    frame->colors = gif_index_frame((const u8*)pixels, TIC80_FULLWIDTH * TIC80_FULLHEIGHT, frame->screen, frame->palette);
+
+    tic_atomic_store(&impl.video.head, head + 1);
+    impl.video.written++;
+
+    if(!impl.video.thread)
+        encodeVideoFrames();
+}
+
 static void recordFrame(u32* pixels)
 {
     if(impl.video.record)
     {
-        if(impl.video.frame < impl.video.frames)
+        // zero length records until stopped
+        if(impl.video.frames <= 0 || impl.video.frame < impl.video.frames)
         {
-            tic_rect rect = {0, 0, TIC80_FULLWIDTH, TIC80_FULLHEIGHT};
-            screen2buffer(impl.video.buffer + (TIC80_FULLWIDTH*TIC80_FULLHEIGHT) * impl.video.frame, pixels, &rect);
+            captureVideoFrame(pixels);
 
             if(impl.video.frame % TIC80_FRAMERATE < TIC80_FRAMERATE / 2)
             {
                 const u32* pal = tic_tool_palette_blit(&impl.config->cart.bank0.palette.scn, TIC80_PIXEL_COLOR_RGBA8888);
                 drawRecordLabel(pixels, TIC80_WIDTH-24, 8, &pal[tic_color_red]);
+                tic_core_blit_invalidate(impl.studio.tic, 8 - TIC80_OFFSET_TOP, 5);
             }
 
             impl.video.frame++;
@@ -1694,9 +1955,68 @@ static void recordFrame(u32* pixels)
         }
         else
         {
-            stopVideoRecord(impl.video.frame == 1 ? ScreenGif : VideoGif);
+            stopVideoRecord();
+        }
+    }
+}
+
+// stacked per-phase frame time bars in the bottom-left corner, 2px per ms
+static void drawProfile(u32* frame)
+{
+    const tic_profile* profile = tic_core_profile_data(impl.studio.tic);
+
+    if(!profile->enabled || !profile->freq)
+        return;
+
+    enum {PxPerMs = 2, Height = 40, Bottom = TIC80_OFFSET_TOP + TIC80_HEIGHT - 1};
+
+    static const u8 Colors[] =
+    {
+        tic_color_purple,
+        tic_color_green,
+        tic_color_yellow,
+        tic_color_blue,
+        tic_color_orange,
+        tic_color_red,
+        tic_color_light_grey,
+    };
+
+    STATIC_ASSERT(profile_colors, COUNT_OF(Colors) == tic_profile_count);
+
+    const u32* pal = tic_tool_palette_blit(&impl.config->cart.bank0.palette.scn, impl.studio.tic->screen_format);
+
+    for(s32 i = 0; i < TIC_PROFILE_FRAMES; i++)
+    {
+        s32 sx = TIC80_OFFSET_LEFT + i;
+
+        for(s32 y = 0; y < Height; y++)
+            frame[sx + ((Bottom - y) << TIC80_FULLWIDTH_BITS)] = pal[tic_color_black];
+
+        // the slot being recorded is left empty as a cursor
+        if(i == profile->frame || (profile->frame - i + TIC_PROFILE_FRAMES) % TIC_PROFILE_FRAMES > profile->count)
+            continue;
+
+        s32 y = 0;
+        double time = 0;
+
+        for(s32 phase = 0; phase < tic_profile_count; phase++)
+        {
+            time += profile->frames[i].time[phase] * 1000.0 * PxPerMs / profile->freq;
+
+            for(; y < Height && y < (s32)(time + .5); y++)
+                frame[sx + ((Bottom - y) << TIC80_FULLWIDTH_BITS)] = pal[Colors[phase]];
         }
     }
+
+    // frame budget line
+    {
+        s32 y = Bottom - (s32)(1000.0 * PxPerMs / TIC80_FRAMERATE);
+
+        for(s32 i = 0; i < TIC_PROFILE_FRAMES; i++)
+            frame[TIC80_OFFSET_LEFT + i + (y << TIC80_FULLWIDTH_BITS)] = pal[tic_color_white];
+    }
+
+    tic_core_blit_invalidate(impl.studio.tic, TIC80_HEIGHT - Height, Height);
 }
 
 static void drawPopup()
@@ -1892,6 +2212,8 @@ static void studioTick()
     tic_mem* tic = impl.studio.tic;
 
     netTickStart(impl.net);
+    fsTick(impl.fs);
+    processSoundExport();
     processShortcuts();
     processMouseStates();
     processGamepadMapping();
@@ -1965,6 +2287,9 @@ static void studioTick()
 
         if(isRecordFrame())
             recordFrame(tic->screen);
+
+        if(impl.mode == TIC_RUN_MODE)
+            drawProfile(tic->screen);
     }
 
     drawPopup();
@@ -1974,6 +2299,9 @@ static void studioTick()
 
 static void studioClose()
 {
+    finishVideoRecord();
+    freeSoundExport();
+
     {
         for(s32 i = 0; i < TIC_EDITOR_BANKS; i++)
         {
@@ -1997,8 +2325,8 @@ static void studioClose()
     if(impl.tic80local)
         tic80_delete((tic80*)impl.tic80local);
 
+    fsClose(impl.fs);
     netClose(impl.net);
-    free(impl.fs);
 }
 
 static StartArgs parseArgs(s32 argc, const char **argv)
@@ -2016,6 +2344,7 @@ static StartArgs parseArgs(s32 argc, const char **argv)
         OPT_HELP(),
         OPT_BOOLEAN('\0',   "skip",         &args.skip,         "skip startup animation"),
         OPT_BOOLEAN('\0',   "nosound",      &args.nosound,      "disable sound output"),
+        OPT_BOOLEAN('\0',   "audiothread",  &args.audiothread,  "synthesize sound on the audio thread"),
         OPT_BOOLEAN('\0',   "fullscreen",   &args.fullscreen,   "enable fullscreen mode"),
         OPT_STRING('\0',    "fs",           &args.fs,           "path to the file system folder"),
         OPT_INTEGER('\0',   "scale",        &args.scale,        "main window scale"),
@@ -2102,6 +2431,9 @@ Studio* studioInit(s32 argc, const char **argv, s32 samplerate, const char* fold
     impl.config->data.goFullscreen = args.fullscreen;
     impl.config->data.noSound = args.nosound;
 
+    if(args.audiothread)
+        impl.config->data.audioThread = true;
+
     impl.studio.tick = studioTick;
     impl.studio.close = studioClose;
     impl.studio.updateProject = updateStudioProject;
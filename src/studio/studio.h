@@ -72,6 +72,7 @@ typedef struct
 {
     bool skip;
     bool nosound;
+    bool audiothread;
     bool fullscreen;
     s32 scale;
     const char *fs;
@@ -181,8 +182,17 @@ const StudioConfig* getConfig();
 const char* md5str(const void* data, s32 length);
 bool hasProjectExt(const char* name);
 void sfx_stop(tic_mem* tic, s32 channel);
-const char* studioExportMusic(s32 track, const char* filename);
-const char* studioExportSfx(s32 sfx, const char* filename);
+
+// sounds are rendered on a worker, the callback is called from the studio tick
+// for every exported file, left is the number of files still to come,
+// export fails if another one is in progress
+typedef void(*StudioExportDone)(void* data, const char* filename, bool done, s32 left);
+bool studioExportMusic(s32 track, const char* filename, StudioExportDone callback, void* data);
+bool studioExportSfx(s32 sfx, const char* filename, StudioExportDone callback, void* data);
+// exports every non empty track of the music bank as name-<track>.wav,
+// returns the number of files or 0 if nothing was started
+s32 studioExportTracks(const char* name, StudioExportDone callback, void* data);
+
 s32 calcWaveAnimation(tic_mem* tic, u32 index, s32 channel);
 void map2ram(tic_ram* ram, const tic_map* src);
 void tiles2ram(tic_ram* ram, const tic_tiles* src);
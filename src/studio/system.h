@@ -113,9 +113,12 @@ typedef struct
 
     s32 gifScale;
     s32 gifLength;
+    s64 cpuBudget;
+    s32 scriptMemory;
     
     bool checkNewVersion;
     bool noSound;
+    bool audioThread;
 
 #if defined(CRT_SHADER_SUPPORT)
     bool crtMonitor;
@@ -0,0 +1,406 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Headless cart runner: ticks a cart without any window or audio device
+// as fast as the CPU allows, replays scripted input and prints per-frame
+// screen hashes plus audio and timing statistics.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <tic80.h>
+
+#if defined(__TIC_WINDOWS__)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define TIC80_EXECUTABLE_NAME "player-headless"
+#define TIC80_DEFAULT_FRAMES (TIC80_FRAMERATE * 60)
+
+typedef struct
+{
+    s32 frame;
+    tic80_input input;
+} InputEvent;
+
+typedef struct
+{
+    u64 count;
+    s32 peak;
+    double sum;
+} SoundStats;
+
+static struct
+{
+    bool quit;
+    bool trace;
+
+    struct
+    {
+        InputEvent* items;
+        s32 count;
+    } events;
+
+} state =
+{
+    .quit = false,
+    .trace = false,
+};
+
+static u64 getPerfCounter()
+{
+#if defined(__TIC_WINDOWS__)
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+static u64 getPerfFrequency()
+{
+#if defined(__TIC_WINDOWS__)
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    return freq.QuadPart;
+#else
+    return 1000000000;
+#endif
+}
+
+static void onExit()
+{
+    state.quit = true;
+}
+
+static void onError(const char* info)
+{
+    fprintf(stderr, "error: %s\n", info);
+}
+
+static void onTrace(const char* text, u8 color)
+{
+    if(state.trace)
+        fprintf(stderr, "%s\n", text);
+}
+
+static void* loadFile(const char* path, s32* size)
+{
+    FILE* file = fopen(path, "rb");
+    void* buffer = NULL;
+
+    if(file)
+    {
+        fseek(file, 0, SEEK_END);
+        *size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        buffer = malloc(*size + 1);
+
+        if(buffer)
+        {
+            if(fread(buffer, *size, 1, file) == 1 || *size == 0)
+                ((char*)buffer)[*size] = '\0';
+            else
+            {
+                free(buffer);
+                buffer = NULL;
+            }
+        }
+
+        fclose(file);
+    }
+
+    return buffer;
+}
+
+// input script format, one event per line, state is kept until the next event:
+// <frame> <gamepads> [<mouse x> <mouse y> <mouse buttons> [<key1> <key2> <key3> <key4>]]
+// gamepads and mouse buttons are hex masks, '#' starts a comment
+static bool loadInput(const char* path)
+{
+    s32 size = 0;
+    char* text = loadFile(path, &size);
+
+    if(!text)
+        return false;
+
+    for(char* line = strtok(text, "\n"); line; line = strtok(NULL, "\n"))
+    {
+        while(*line == ' ' || *line == '\t') line++;
+
+        if(*line == '#' || *line == '\r' || *line == '\0')
+            continue;
+
+        InputEvent event;
+        memset(&event, 0, sizeof event);
+
+        u32 gamepads = 0, btns = 0, x = 0, y = 0, keys[TIC80_KEY_BUFFER] = {0};
+
+        s32 count = sscanf(line, "%d %x %u %u %x %u %u %u %u", &event.frame, &gamepads,
+            &x, &y, &btns, &keys[0], &keys[1], &keys[2], &keys[3]);
+
+        if(count < 2)
+        {
+            fprintf(stderr, "Error: invalid input line '%s'\n", line);
+            free(text);
+            return false;
+        }
+
+        event.input.gamepads.data = gamepads;
+        event.input.mouse.x = x;
+        event.input.mouse.y = y;
+        event.input.mouse.btns = btns;
+
+        for(s32 i = 0; i < TIC80_KEY_BUFFER; i++)
+            event.input.keyboard.keys[i] = keys[i];
+
+        state.events.items = realloc(state.events.items, (state.events.count + 1) * sizeof(InputEvent));
+        state.events.items[state.events.count++] = event;
+    }
+
+    free(text);
+
+    return true;
+}
+
+// FNV-1a
+static u32 hashScreen(const u32* screen)
+{
+    enum { Size = TIC80_FULLWIDTH * TIC80_FULLHEIGHT * sizeof(u32) };
+
+    const u8* ptr = (const u8*)screen;
+    const u8* end = ptr + Size;
+    u32 hash = 2166136261u;
+
+    while(ptr != end)
+    {
+        hash ^= *ptr++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static void outputSound(SoundStats* stats, const s16* samples, s32 count, FILE* file)
+{
+    for(s32 i = 0; i < count; i++)
+    {
+        s32 sample = samples[i];
+        s32 amp = sample < 0 ? -sample : sample;
+
+        if(amp > stats->peak) stats->peak = amp;
+        stats->sum += (double)sample * sample;
+    }
+
+    stats->count += count;
+
+    if(file)
+        fwrite(samples, sizeof samples[0], count, file);
+}
+
+static void printUsage(const char* executable)
+{
+    printf("Usage: %s <cart> [options]\n\n"
+        "  -f, --frames <n>     number of frames to run (default %d)\n"
+        "  -i, --input <file>   scripted input, '<frame> <gamepads> [mx my mbtns [keys...]]' per line\n"
+        "  -e, --every <n>      print screen hash every n-th frame, 0 to disable (default 1)\n"
+        "  -a, --audio <file>   write raw s16 samples to file\n"
+        "  -r, --rate <hz>      audio sample rate (default %d)\n"
+        "  -c, --channels <n>   1 for mono mixdown, 2 for stereo (default 2)\n"
+        "  -b, --block <n>      pull audio in blocks of n samples per channel instead of per tick\n"
+        "  -t, --trace          print cart trace() output to stderr\n",
+        executable, TIC80_DEFAULT_FRAMES, TIC80_SAMPLERATE);
+}
+
+s32 main(s32 argc, char **argv)
+{
+    const char* executable = argc > 0 ? argv[0] : TIC80_EXECUTABLE_NAME;
+    const char* cartPath = NULL;
+    const char* inputPath = NULL;
+    const char* audioPath = NULL;
+    s32 frames = TIC80_DEFAULT_FRAMES;
+    s32 every = 1;
+    s32 block = 0;
+    tic80_sound_config config = {TIC80_SAMPLERATE, 2, 0};
+
+    for(s32 i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* next = i + 1 < argc ? argv[i + 1] : NULL;
+
+#define ARG(S, L) (strcmp(arg, S) == 0 || strcmp(arg, L) == 0)
+
+        if(ARG("-h", "--help"))
+        {
+            printUsage(executable);
+            return 0;
+        }
+        else if(ARG("-t", "--trace"))
+            state.trace = true;
+        else if(next && ARG("-f", "--frames"))
+            frames = atoi(argv[++i]);
+        else if(next && ARG("-e", "--every"))
+            every = atoi(argv[++i]);
+        else if(next && ARG("-i", "--input"))
+            inputPath = argv[++i];
+        else if(next && ARG("-a", "--audio"))
+            audioPath = argv[++i];
+        else if(next && ARG("-r", "--rate"))
+            config.samplerate = atoi(argv[++i]);
+        else if(next && ARG("-c", "--channels"))
+            config.channels = atoi(argv[++i]);
+        else if(next && ARG("-b", "--block"))
+            block = atoi(argv[++i]);
+        else if(*arg != '-' && !cartPath)
+            cartPath = arg;
+        else
+        {
+            fprintf(stderr, "Error: unknown option '%s'\n\n", arg);
+            printUsage(executable);
+            return 1;
+        }
+
+#undef ARG
+    }
+
+    if(!cartPath)
+    {
+        printUsage(executable);
+        return 1;
+    }
+
+    if(inputPath && !loadInput(inputPath))
+    {
+        fprintf(stderr, "Error: Could not load input %s.\n", inputPath);
+        return 1;
+    }
+
+    FILE* audio = NULL;
+
+    if(audioPath && !(audio = fopen(audioPath, "wb")))
+    {
+        fprintf(stderr, "Error: Could not open %s.\n", audioPath);
+        return 1;
+    }
+
+    // blocks are pulled right after every tick, so one frame of latency is enough
+    if(block > 0)
+        config.latency = 1000 / TIC80_FRAMERATE;
+
+    s16* blockSamples = block > 0 ? malloc(block * config.channels * sizeof(s16)) : NULL;
+    tic80* tic = tic80_create_ex(&config);
+
+    if(!tic)
+    {
+        fprintf(stderr, "Error: Failed to create tic80 instance.\n");
+        free(blockSamples);
+        return 1;
+    }
+
+    tic->callback.exit = onExit;
+    tic->callback.error = onError;
+    tic->callback.trace = onTrace;
+
+    if(!tic80_load_file(tic, cartPath))
+    {
+        fprintf(stderr, "Error: Could not load %s.\n", cartPath);
+        tic80_delete(tic);
+        free(blockSamples);
+        return 1;
+    }
+
+    tic80_input input;
+    memset(&input, 0, sizeof input);
+
+    struct
+    {
+        u64 total;
+        u64 min;
+        u64 max;
+    } time = {0, (u64)-1, 0};
+
+    SoundStats sound = {0, 0, 0.0};
+
+    s32 frame = 0, event = 0;
+    u64 pulled = 0;
+
+    for(; frame < frames && !state.quit; frame++)
+    {
+        while(event < state.events.count && state.events.items[event].frame <= frame)
+            input = state.events.items[event++].input;
+
+        u64 start = getPerfCounter();
+        tic80_tick(tic, &input);
+        u64 delta = getPerfCounter() - start;
+
+        time.total += delta;
+        if(delta < time.min) time.min = delta;
+        if(delta > time.max) time.max = delta;
+
+        if(block > 0)
+        {
+            // pull the blocks which became due with this tick
+            for(; (pulled + block) * TIC80_FRAMERATE <= (u64)config.samplerate * (frame + 1); pulled += block)
+            {
+                tic80_sound_read(tic, blockSamples, block * config.channels);
+                outputSound(&sound, blockSamples, block * config.channels, audio);
+            }
+        }
+        else outputSound(&sound, tic->sound.samples, tic->sound.count, audio);
+
+        if(every > 0 && frame % every == 0)
+            printf("%d %08x\n", frame, hashScreen(tic->screen));
+    }
+
+    tic80_delete(tic);
+    free(blockSamples);
+
+    if(audio)
+        fclose(audio);
+
+    free(state.events.items);
+
+    {
+        const double ms = 1000.0 / getPerfFrequency();
+        const double total = time.total * ms;
+
+        fprintf(stderr, "frames: %d%s\n", frame, state.quit ? " (exit)" : "");
+
+        if(frame)
+            fprintf(stderr, "time: %.3f ms total, %.4f ms avg, %.4f ms min, %.4f ms max, %.1f fps (%.1fx realtime)\n",
+                total, total / frame, time.min * ms, time.max * ms,
+                total > 0 ? frame * 1000.0 / total : 0, total > 0 ? frame * 1000.0 / TIC80_FRAMERATE / total : 0);
+
+        fprintf(stderr, "audio: %llu samples, peak %d, rms %.2f\n",
+            (unsigned long long)sound.count, sound.peak, sound.count ? sqrt(sound.sum / sound.count) : 0);
+    }
+
+    return 0;
+}
@@ -250,7 +250,7 @@ RETRO_API void retro_get_system_info(struct retro_system_info *info)
 	info->library_name     = TIC_NAME;
 	info->library_version  = TIC_VERSION_LABEL;
 	info->valid_extensions = "tic";
-	info->need_fullpath    = false;
+	info->need_fullpath    = true; // carts are mapped by the core
 	info->block_extract    = false;
 }
 
@@ -727,7 +727,7 @@ RETRO_API bool retro_load_game(const struct retro_game_info *info)
 	}
 
 	// Ensure content data is available.
-	if (info->data == NULL) {
+	if (info->data == NULL && info->path == NULL) {
 		log_cb(RETRO_LOG_ERROR, "[TIC-80] No content data provided.\n");
 		return false;
 	}
@@ -752,7 +752,15 @@ RETRO_API bool retro_load_game(const struct retro_game_info *info)
 
 	// Load the content.
 	// TODO: Allow loading code files directly.
-	tic80_load(state->tic, (void*)(info->data), (int)info->size);
+	if (info->data != NULL) {
+		tic80_load(state->tic, (void*)(info->data), (int)info->size);
+	}
+	else if (!tic80_load_file(state->tic, info->path)) {
+		log_cb(RETRO_LOG_ERROR, "[TIC-80] Failed to read the content file.\n");
+		retro_unload_game();
+		return false;
+	}
+
 	if (state->tic == NULL) {
 		log_cb(RETRO_LOG_ERROR, "[TIC-80] Content loaded, but failed to load game.\n");
 		retro_unload_game();
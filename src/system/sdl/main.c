@@ -44,6 +44,7 @@
 #endif
 
 #define TEXTURE_SIZE (TIC80_FULLWIDTH)
+#define SOUND_STREAM_FRAMES 8
 
 #if defined(__TIC_WINDOWS__)
 #include <windows.h>
@@ -167,6 +168,7 @@ static struct
         SDL_AudioSpec       spec;
         SDL_AudioDeviceID   device;
         SDL_AudioCVT        cvt;
+        bool                stream;
     } audio;
 } platform
 #if defined(TOUCH_INPUT_SUPPORT)
@@ -204,6 +206,40 @@ static void initSound()
     }
 }
 
+static void audioCallback(void* userdata, u8* stream, s32 len)
+{
+    tic_core_sound_read(platform.studio->tic, (s16*)stream, len / sizeof(s16));
+}
+
+// reopens the device in callback mode, the samples are synthesized there
+static void initSoundStream()
+{
+    SDL_AudioSpec want =
+    {
+        .freq = platform.audio.spec.freq,
+        .format = AUDIO_S16,
+        .channels = TIC_STEREO_CHANNELS,
+        .samples = 1024,
+        .callback = audioCallback,
+        .userdata = NULL,
+    };
+
+    SDL_AudioSpec spec;
+    SDL_AudioDeviceID device = SDL_OpenAudioDevice(NULL, 0, &want, &spec, 0);
+
+    if(device)
+    {
+        if(tic_core_sound_stream(platform.studio->tic, SOUND_STREAM_FRAMES))
+        {
+            SDL_CloseAudioDevice(platform.audio.device);
+
+            platform.audio.device = device;
+            platform.audio.stream = true;
+        }
+        else SDL_CloseAudioDevice(device);
+    }
+}
+
 static const u8* getSpritePtr(const tic_tile* tiles, s32 x, s32 y)
 {
     enum { SheetCols = (TIC_SPRITESHEET_SIZE / TIC_SPRITESIZE) };
@@ -1029,6 +1065,9 @@ static void blitSound()
     tic_mem* tic = platform.studio->tic;
 
     SDL_PauseAudioDevice(platform.audio.device, 0);
+
+    if(platform.audio.stream)
+        return;
     
     if(platform.audio.cvt.needed)
     {
@@ -1585,6 +1624,9 @@ static s32 start(s32 argc, const char **argv, const char* folder)
 
     platform.studio = studioInit(argc, argv, platform.audio.spec.freq, folder);
 
+    if(platform.studio->config()->audioThread)
+        initSoundStream();
+
     {
         const s32 Width = TIC80_FULLWIDTH * platform.studio->config()->uiScale;
         const s32 Height = TIC80_FULLHEIGHT * platform.studio->config()->uiScale;
@@ -1641,6 +1683,10 @@ static s32 start(s32 argc, const char **argv, const char* folder)
         SDL_StopTextInput();
 #endif
 
+    // the callback must not run while the core is closed
+    if(platform.audio.stream)
+        SDL_PauseAudioDevice(platform.audio.device, 1);
+
     platform.studio->close();
 
     if(platform.audio.cvt.buf)
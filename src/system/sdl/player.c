@@ -43,7 +43,7 @@ static void onExit()
 	state.quit = true;
 }
 
-s32 runCart(void* cart, s32 size)
+s32 runCart(const char* path)
 {
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
 
@@ -81,15 +81,18 @@ s32 runCart(void* cart, s32 size)
 	SDL_memset(&input, 0, sizeof input);
 
 	tic80* tic = tic80_create(audioSpec.freq);
-	tic->callback.exit = onExit;
-	tic80_load(tic, cart, size);
 
-	if(!tic)
+	if(!tic || !tic80_load_file(tic, path))
 	{
-		fprintf(stderr, "Failed to load cart data.");
+		fprintf(stderr, "Error: Could not load %s.\n", path);
 		output = 1;
+
+		if(tic)
+			tic80_delete(tic);
 	}
 	else {
+		tic->callback.exit = onExit;
+
 		u64 nextTick = SDL_GetPerformanceCounter();
 		const u64 Delta = SDL_GetPerformanceFrequency() / TIC80_FRAMERATE;
 
@@ -206,7 +209,6 @@ s32 runCart(void* cart, s32 size)
 	SDL_DestroyWindow(window);
 	SDL_CloseAudioDevice(audioDevice);
 
-	SDL_free(cart);
 	return output;
 }
 
@@ -222,28 +224,6 @@ s32 main(s32 argc, char **argv)
 		return 0;
 	}
 
-	// Load the given file.
-	FILE* file = fopen(input, "rb");
-	if(!file)
-	{
-		fprintf(stderr, "Error: Could not load %s.\n\nUsage: %s <file>\n", input, argv[0]);
-		return 1;
-	}
-
-	// Load the file data.
-	fseek(file, 0, SEEK_END);
-	s32 size = ftell(file);
-	fseek(file, 0, SEEK_SET);
-
-	// Read the data into usable memory.
-	void* cart = SDL_malloc(size);
-	if(cart) fread(cart, size, 1, file);
-	fclose(file);
-
-	if (!cart) {
-		fprintf(stderr, "Error reading %s.\n", input);
-		return 1;
-	}
-
-	return runCart(cart, size);
+	// The cart is mapped and parsed in place by the core.
+	return runCart(input);
 }
@@ -0,0 +1,162 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "thread.h"
+
+#include <stdlib.h>
+
+#if defined(TIC_BUILD_WITH_THREADS)
+
+#if defined(__TIC_WINDOWS__)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+struct tic_thread
+{
+    tic_thread_func func;
+    void* data;
+
+#if defined(__TIC_WINDOWS__)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+};
+
+#if defined(__TIC_WINDOWS__)
+static DWORD WINAPI threadProc(LPVOID param)
+#else
+static void* threadProc(void* param)
+#endif
+{
+    tic_thread* thread = param;
+    thread->func(thread->data);
+    return 0;
+}
+
+tic_thread* tic_thread_create(tic_thread_func func, void* data)
+{
+    tic_thread* thread = malloc(sizeof(tic_thread));
+
+    if(thread)
+    {
+        thread->func = func;
+        thread->data = data;
+
+#if defined(__TIC_WINDOWS__)
+        thread->handle = CreateThread(NULL, 0, threadProc, thread, 0, NULL);
+        if(!thread->handle)
+#else
+        if(pthread_create(&thread->handle, NULL, threadProc, thread) != 0)
+#endif
+        {
+            free(thread);
+            thread = NULL;
+        }
+    }
+
+    return thread;
+}
+
+void tic_thread_join(tic_thread* thread)
+{
+#if defined(__TIC_WINDOWS__)
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+
+    free(thread);
+}
+
+s32 tic_thread_cores()
+{
+#if defined(__TIC_WINDOWS__)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (s32)count : 1;
+#else
+    return 1;
+#endif
+}
+
+void tic_thread_sleep(s32 ms)
+{
+#if defined(__TIC_WINDOWS__)
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+#else
+
+tic_thread* tic_thread_create(tic_thread_func func, void* data)
+{
+    return NULL;
+}
+
+void tic_thread_join(tic_thread* thread) {}
+
+s32 tic_thread_cores()
+{
+    return 1;
+}
+
+void tic_thread_sleep(s32 ms) {}
+
+#endif
+
+#if defined(_MSC_VER)
+
+#include <windows.h>
+
+s32 tic_atomic_load(const volatile s32* ptr)
+{
+    return InterlockedCompareExchange((volatile LONG*)ptr, 0, 0);
+}
+
+void tic_atomic_store(volatile s32* ptr, s32 value)
+{
+    InterlockedExchange((volatile LONG*)ptr, value);
+}
+
+#else
+
+s32 tic_atomic_load(const volatile s32* ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void tic_atomic_store(volatile s32* ptr, s32 value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,42 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "tic.h"
+
+// minimal worker thread wrapper, threads are only available when the core is
+// built with TIC_BUILD_WITH_THREADS, otherwise tic_thread_create returns NULL
+// and callers are expected to run the job in place
+
+typedef struct tic_thread tic_thread;
+typedef void(*tic_thread_func)(void* data);
+
+tic_thread* tic_thread_create(tic_thread_func func, void* data);
+void tic_thread_join(tic_thread* thread);
+s32 tic_thread_cores();
+void tic_thread_sleep(s32 ms);
+
+// acquire load and release store, enough to pass data between one producer
+// and one consumer thread
+s32 tic_atomic_load(const volatile s32* ptr);
+void tic_atomic_store(volatile s32* ptr, s32 value);
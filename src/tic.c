@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 
 #include <tic80.h>
 #include "api.h"
@@ -30,6 +31,14 @@
 
 #include "ext/gif.h"
 
+#if defined(__TIC_LINUX__)
+#define TIC_MMAP_SUPPORT
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 static void onTrace(void* data, const char* text, u8 color)
 {
     tic80* tic = (tic80*)data;
@@ -54,6 +63,80 @@ static void onExit(void* data)
         tic->callback.exit();
 }
 
+#if defined(TIC_MMAP_SUPPORT)
+
+static void* mapFile(const char* path, s32* size)
+{
+    void* data = NULL;
+    s32 fd = open(path, O_RDONLY);
+
+    if(fd >= 0)
+    {
+        struct stat st;
+
+        if(fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size <= INT32_MAX)
+        {
+            data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if(data == MAP_FAILED)
+                data = NULL;
+            else
+            {
+                // the file is read once from start to end
+                madvise(data, st.st_size, MADV_SEQUENTIAL);
+                *size = (s32)st.st_size;
+            }
+        }
+
+        close(fd);
+    }
+
+    return data;
+}
+
+static void unmapFile(void* data, s32 size)
+{
+    munmap(data, size);
+}
+
+#else
+
+static void* mapFile(const char* path, s32* size)
+{
+    FILE* file = fopen(path, "rb");
+    void* data = NULL;
+
+    if(file)
+    {
+        fseek(file, 0, SEEK_END);
+        *size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        if(*size > 0 && (data = malloc(*size)) && fread(data, *size, 1, file) != 1)
+        {
+            free(data);
+            data = NULL;
+        }
+
+        fclose(file);
+    }
+
+    return data;
+}
+
+static void unmapFile(void* data, s32 size)
+{
+    free(data);
+}
+
+#endif
+
+static void downmix(const s16* stereo, s16* mono, s32 count)
+{
+    for(s32 i = 0; i < count; i++, stereo += TIC_STEREO_CHANNELS)
+        mono[i] = (stereo[0] + stereo[1]) / 2;
+}
+
 static u64 getFreq(void* data)
 {
     return TIC80_FRAMERATE;
@@ -66,6 +149,12 @@ static u64 getCounter(void* data)
 }
 
 tic80* tic80_create(s32 samplerate)
+{
+    tic80_sound_config sound = {.samplerate = samplerate};
+    return tic80_create_ex(&sound);
+}
+
+TIC80_API tic80* tic80_create_ex(const tic80_sound_config* sound)
 {
     tic80_local* tic80 = malloc(sizeof(tic80_local));
 
@@ -73,8 +162,37 @@ tic80* tic80_create(s32 samplerate)
     {
         memset(tic80, 0, sizeof(tic80_local));
 
-        tic80->memory = tic_core_create(samplerate);
+        tic80->memory = tic_core_create(sound->samplerate > 0 ? sound->samplerate : TIC80_SAMPLERATE);
+
+        if(!tic80->memory)
+        {
+            free(tic80);
+            return NULL;
+        }
+
         tic80->tic.screen_format = tic80->memory->screen_format;
+        tic80->sound.channels = sound->channels == 1 ? 1 : TIC_STEREO_CHANNELS;
+
+        if(sound->latency > 0)
+        {
+            enum { MsPerSecond = 1000 };
+            s32 frames = MAX(1, (sound->latency * TIC80_FRAMERATE + MsPerSecond - 1) / MsPerSecond);
+
+            tic80->sound.stream = tic_core_sound_stream(tic80->memory, frames);
+        }
+
+        // per frame samples when there is no stream, the host still expects mono ones
+        if(!tic80->sound.stream && tic80->sound.channels == 1)
+        {
+            tic80->sound.mono = malloc(tic80->memory->samples.size / TIC_STEREO_CHANNELS);
+
+            if(!tic80->sound.mono)
+            {
+                tic_core_close(tic80->memory);
+                free(tic80);
+                return NULL;
+            }
+        }
 
         return &tic80->tic;
     }
@@ -82,12 +200,23 @@ tic80* tic80_create(s32 samplerate)
     return NULL;
 }
 
-TIC80_API void tic80_load(tic80* tic, void* cart, s32 size)
+static void initLoad(tic80_local* tic80)
 {
-    tic80_local* tic80 = (tic80_local*)tic;
-
-    tic80->tic.sound.count = tic80->memory->samples.size/sizeof(s16);
-    tic80->tic.sound.samples = tic80->memory->samples.buffer;
+    if(tic80->sound.stream)
+    {
+        tic80->tic.sound.count = 0;
+        tic80->tic.sound.samples = NULL;
+    }
+    else if(tic80->sound.mono)
+    {
+        tic80->tic.sound.count = tic80->memory->samples.size / sizeof(s16) / TIC_STEREO_CHANNELS;
+        tic80->tic.sound.samples = tic80->sound.mono;
+    }
+    else
+    {
+        tic80->tic.sound.count = tic80->memory->samples.size / sizeof(s16);
+        tic80->tic.sound.samples = tic80->memory->samples.buffer;
+    }
 
     tic80->tic.screen = tic80->memory->screen;
 
@@ -100,13 +229,47 @@ TIC80_API void tic80_load(tic80* tic, void* cart, s32 size)
         tic80->tickData.start = 0;
         tic80->tickData.freq = getFreq;
         tic80->tickData.counter = getCounter;
+        tic80->tickData.budget = tic80->limits.budget;
+        tic80->tickData.memory = tic80->limits.memory;
+        tic80->tickData.cacheLoad = NULL;
+        tic80->tickData.cacheSave = NULL;
         tic80->tick_counter = 0;
     }
+}
 
-    {
-        tic_cart_load(&tic80->memory->cart, cart, size);
-        tic_api_reset(tic80->memory);
-    }
+TIC80_API void tic80_load(tic80* tic, void* cart, s32 size)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    initLoad(tic80);
+
+    tic_cart_load(&tic80->memory->cart, cart, size);
+    tic_api_reset(tic80->memory);
+}
+
+TIC80_API bool tic80_load_file(tic80* tic, const char* path)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    s32 size = 0;
+    void* data = mapFile(path, &size);
+
+    if(!data)
+        return false;
+
+    initLoad(tic80);
+
+    // chunks are parsed straight from the mapping, without an intermediate
+    // copy of the file or of the code banks
+    tic_cart_index index;
+    tic_cart_scan(&index, data, size);
+    tic_cart_load_index(&tic80->memory->cart, &index);
+
+    unmapFile(data, size);
+
+    tic_api_reset(tic80->memory);
+
+    return true;
 }
 
 TIC80_API void tic80_tick(tic80* tic, const tic80_input* input)
@@ -122,6 +285,9 @@ TIC80_API void tic80_tick(tic80* tic, const tic80_input* input)
 
     tic_core_blit(tic80->memory, tic80->memory->screen_format);
 
+    if(tic80->sound.mono)
+        downmix(tic80->memory->samples.buffer, tic80->sound.mono, tic80->tic.sound.count);
+
     tic80->tick_counter++;
 }
 
@@ -131,5 +297,46 @@ TIC80_API void tic80_delete(tic80* tic)
 
     tic_core_close(tic80->memory);
 
+    free(tic80->sound.mono);
     free(tic80);
 }
+
+TIC80_API void tic80_sound_read(tic80* tic, s16* samples, s32 count)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    if(tic80->sound.channels == TIC_STEREO_CHANNELS)
+    {
+        tic_core_sound_read(tic80->memory, samples, count);
+        return;
+    }
+
+    enum { Block = 256 };
+    s16 stereo[Block * TIC_STEREO_CHANNELS];
+
+    while(count > 0)
+    {
+        s32 size = MIN(count, Block);
+
+        tic_core_sound_read(tic80->memory, stereo, size * TIC_STEREO_CHANNELS);
+        downmix(stereo, samples, size);
+
+        samples += size;
+        count -= size;
+    }
+}
+
+TIC80_API void tic80_script_limits(tic80* tic, u64 budget, u32 memory)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    tic80->limits.budget = budget;
+    tic80->limits.memory = memory;
+}
+
+TIC80_API void tic80_script_stats(tic80* tic, tic80_script_memory* stats)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    *stats = *tic_core_script_memory(tic80->memory);
+}
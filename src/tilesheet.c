@@ -29,25 +29,25 @@ static const tic_blit_segment segments[] = {
     //   +page +nb_pages 
     //   |  +bank +bank_size
     //   |  |  |  |     +sheet_width
-    //   |  |  |  |     |   +tile_width
-        {0, 0, 1, 256,  16, 8,  TIC_SPRITESIZE,   tic_tool_peek1, tic_tool_poke1}, // system gfx
-        {0, 0, 1, 256,  16, 8,  TIC_SPRITESIZE,   tic_tool_peek1, tic_tool_poke1}, // system font
-        {0, 0, 1, 256,  16, 8,  sizeof(tic_tile), tic_tool_peek4, tic_tool_poke4}, // 4bpp p0 bg
-        {0, 1, 1, 256,  16, 8,  sizeof(tic_tile), tic_tool_peek4, tic_tool_poke4}, // 4bpp p0 fg
-
-        {0, 0, 2, 512,  32, 16, sizeof(tic_tile), tic_tool_peek2, tic_tool_poke2}, // 2bpp p0 bg
-        {1, 0, 2, 512,  32, 16, sizeof(tic_tile), tic_tool_peek2, tic_tool_poke2}, // 2bpp p1 bg
-        {0, 1, 2, 512,  32, 16, sizeof(tic_tile), tic_tool_peek2, tic_tool_poke2}, // 2bpp p0 fg
-        {1, 1, 2, 512,  32, 16, sizeof(tic_tile), tic_tool_peek2, tic_tool_poke2}, // 2bpp p1 fg
-
-        {0, 0, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1}, // 1bpp p0 bg
-        {1, 0, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1}, // 1bpp p1 bg
-        {2, 0, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1}, // 1bpp p2 bg
-        {3, 0, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1}, // 1bpp p3 bg
-        {0, 1, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1}, // 1bpp p0 fg
-        {1, 1, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1}, // 1bpp p1 fg
-        {2, 1, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1}, // 1bpp p2 fg
-        {3, 1, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1}, // 1bpp p3 fg
+    //   |  |  |  |     |   +tile_width                                       +bpp
+        {0, 0, 1, 256,  16, 8,  TIC_SPRITESIZE,   tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // system gfx
+        {0, 0, 1, 256,  16, 8,  TIC_SPRITESIZE,   tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // system font
+        {0, 0, 1, 256,  16, 8,  sizeof(tic_tile), tic_tool_peek4, tic_tool_poke4, tic_bpp_4}, // 4bpp p0 bg
+        {0, 1, 1, 256,  16, 8,  sizeof(tic_tile), tic_tool_peek4, tic_tool_poke4, tic_bpp_4}, // 4bpp p0 fg
+
+        {0, 0, 2, 512,  32, 16, sizeof(tic_tile), tic_tool_peek2, tic_tool_poke2, tic_bpp_2}, // 2bpp p0 bg
+        {1, 0, 2, 512,  32, 16, sizeof(tic_tile), tic_tool_peek2, tic_tool_poke2, tic_bpp_2}, // 2bpp p1 bg
+        {0, 1, 2, 512,  32, 16, sizeof(tic_tile), tic_tool_peek2, tic_tool_poke2, tic_bpp_2}, // 2bpp p0 fg
+        {1, 1, 2, 512,  32, 16, sizeof(tic_tile), tic_tool_peek2, tic_tool_poke2, tic_bpp_2}, // 2bpp p1 fg
+
+        {0, 0, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // 1bpp p0 bg
+        {1, 0, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // 1bpp p1 bg
+        {2, 0, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // 1bpp p2 bg
+        {3, 0, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // 1bpp p3 bg
+        {0, 1, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // 1bpp p0 fg
+        {1, 1, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // 1bpp p1 fg
+        {2, 1, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // 1bpp p2 fg
+        {3, 1, 4, 1024, 64, 32, sizeof(tic_tile), tic_tool_peek1, tic_tool_poke1, tic_bpp_1}, // 1bpp p3 fg
 };
 
 extern u8 tic_tilesheet_getpix(const tic_tilesheet* sheet, s32 x, s32 y);
@@ -55,6 +55,14 @@ extern void tic_tilesheet_setpix(const tic_tilesheet* sheet, s32 x, s32 y, u8 va
 extern u8 tic_tilesheet_gettilepix(const tic_tileptr* tile, s32 x, s32 y);
 extern void tic_tilesheet_settilepix(const tic_tileptr* tile, s32 x, s32 y, u8 value);
 
+#define TIC_TILESHEET_GETPIX_EXTERN(BPP)                                                \
+    extern u8 tic_tilesheet_getpix##BPP(const tic_tilesheet* sheet, s32 x, s32 y);     \
+    extern u8 tic_tilesheet_gettilepix##BPP(const tic_tileptr* tile, s32 x, s32 y);
+
+TIC_BPP_LIST(TIC_TILESHEET_GETPIX_EXTERN)
+
+#undef TIC_TILESHEET_GETPIX_EXTERN
+
 tic_tilesheet tic_tilesheet_get(u8 segment, u8* ptr)
 {
     return (tic_tilesheet) { &segments[segment], ptr };
@@ -36,6 +36,7 @@ typedef struct
     size_t ptr_size;
     u8     (*peek)(const void*, u32);
     void   (*poke)(void*, u32, u8);
+    tic_bpp bpp;
 } tic_blit_segment;
 
 typedef struct
@@ -84,6 +85,27 @@ inline void tic_tilesheet_settilepix(const tic_tileptr* tile, s32 x, s32 y, u8 v
     tile->segment->poke(tile->ptr, addr, value);
 }
 
+// bpp specialized versions of the getters above without the indirect peek call,
+// switch on segment->bpp once per draw call and use them in the pixel loops
+#define TIC_BPP_LIST(macro) macro(1) macro(2) macro(4)
+
+#define TIC_TILESHEET_GETPIX_DEF(BPP)                                                                   \
+inline u8 tic_tilesheet_getpix##BPP(const tic_tilesheet* sheet, s32 x, s32 y)                           \
+{                                                                                                       \
+    u16 tile_index = ((y >> 3) << 4 ) + (x / sheet->segment->tile_width);                               \
+    u32 pix_addr = ((x & (sheet->segment->tile_width - 1)) + ((y & 7) * sheet->segment->tile_width));   \
+    return tic_tool_peek##BPP(sheet->ptr + tile_index * sheet->segment->ptr_size, pix_addr);            \
+}                                                                                                       \
+                                                                                                        \
+inline u8 tic_tilesheet_gettilepix##BPP(const tic_tileptr* tile, s32 x, s32 y)                          \
+{                                                                                                       \
+    return tic_tool_peek##BPP(tile->ptr, tile->offset + x + (y * tile->segment->tile_width));           \
+}
+
+TIC_BPP_LIST(TIC_TILESHEET_GETPIX_DEF)
+
+#undef TIC_TILESHEET_GETPIX_DEF
+
 typedef struct
 {
     tic_bpp mode;